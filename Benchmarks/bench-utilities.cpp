@@ -0,0 +1,593 @@
+/*
+ * bench-utilities.cpp
+ * Host-side microbenchmarks for the pure-software parts of the library:
+ * CircBuf_c, SerialStream formatting/parsing and the arduino-funcs templates.
+ *
+ * None of these files touch hardware registers, so they build on a Linux
+ * host without sam.h. From the repository root:
+ *     g++ -O2 -std=gnu++11 -o bench-utilities Benchmarks/bench-utilities.cpp
+ *     ./bench-utilities > bench_output.txt
+ *
+ * Timings are host nanoseconds, so compare entries against each other 
+ * (e.g. itoa_legacy_* against itoa_*) rather than reading them as M4 cycles.
+ * Output is one JSON object per line, so results can be diffed or
+ * collected between releases:
+ *     {"bench": "...", "ops": N, "ns_per_op": X, "bytes_per_s": Y}
+ *
+ * Created: 17/10/2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "../Utilities/CircBuf.hpp"
+#include "../Utilities/serial-funcs.hpp"
+#include "../Utilities/serial-parse.hpp"
+#include "../Utilities/serial-shell.hpp"
+#include "../Utilities/serial-packet.hpp"
+#include "../Utilities/arduino-funcs.hpp"
+
+
+#define BENCH_STREAM_LENGTH 4096
+
+//Stops the compiler from optimising away benchmark results.
+volatile uint32_t benchSink;
+
+
+//////////////////////////////////////////////////////////////////////////
+//In-memory SerialStream, standing in for samUART_c on the host:
+
+class benchStream_c: public SerialStream {
+	public:
+		uint32_t Available(void) { return this->rx.Available(); }
+		int16_t Read(void) { return this->rx.Available() ? this->rx.Pop() : -1; }
+		int16_t Peek(void) { return this->rx.Available() ? this->rx.Peek() : -1; }
+		//Like the drivers, every write also sets an interrupt enable register, and 
+		// is a real call rather than inlined into the caller.
+		__attribute__((noinline)) void Write(uint8_t byte) { this->tx.Push(byte); this->txCount++; this->fakeIER = 1; }
+		__attribute__((noinline)) uint32_t WriteBlock(const uint8_t* data, uint32_t num_bytes) { this->txCount += num_bytes; this->fakeIER = 1; return this->tx.PushN(data, num_bytes); }
+		uint32_t ReadBlock(uint8_t* data, uint32_t num_bytes) { return this->rx.PopN(data, num_bytes); }
+
+		//Expose the protected number routines to the benchmarks:
+		void BenchPrintNum(int64_t value) { this->PrintNum(value, true, 10, 0); }
+		static char* BenchNumToAscii(char* end, int64_t value, bool signedValue, uint32_t base) { return numToAscii(end, value, signedValue, base, 0); }
+		int64_t BenchReadNum(uint32_t base) { return this->ReadNum(base); }
+		//Line framing as the drivers do it, on the receive buffer:
+		bool LineGet(serialLine_t* line) { return serialLineGet(&this->rx, &this->lineState, line); }
+		bool LineRelease(void) { return serialLineRelease(&this->rx, &this->lineState); }
+		serialLineState_t lineState;
+
+		//Test harness access to both ends of the "wire":
+		void Feed(const char* text) { while (*text) this->rx.Push(*(text++)); }
+		void Drain(void) { uint8_t scratch[64]; while (this->tx.PopN(scratch, sizeof(scratch))); }
+		uint32_t TakeWritten(uint8_t* data, uint32_t num_bytes) { return this->tx.PopN(data, num_bytes); }
+
+		uint32_t txCount;
+
+	private:
+		volatile uint32_t fakeIER; // Stands in for the peripheral register.
+		CircBuf_c<uint8_t, BENCH_STREAM_LENGTH> rx;
+		CircBuf_c<uint8_t, BENCH_STREAM_LENGTH> tx;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+//Baseline: printf as it was before output was buffered - one virtual Write() 
+// per character, numbers included. Kept here so the gain stays measurable.
+
+static void benchLegacyPrintNum(SerialStream* stream, int64_t value, bool signedValue, uint32_t base, uint32_t whitespace_pad) {
+	char buff[50];
+	char* ptr = buff + sizeof(buff) - 1;
+
+	if ((value < 0) && signedValue) {
+		stream->Write('-');
+		value = -value;
+	}
+	*ptr = '\0';
+	do {
+		*(--ptr) = SerialAsciiTable[value % base];
+		value /= base;
+	} while (value > 0 && ptr > buff);
+	while ((uint32_t)(buff - ptr + (int)sizeof(buff)) < whitespace_pad && ptr > buff) {
+		*(--ptr) = ' ';
+	}
+	while (*ptr) {
+		stream->Write(*(ptr++));
+	}
+}
+
+//The old conversion loop on its own: 64-bit divide and modulo per digit.
+static char* benchLegacyNumToAscii(char* end, int64_t value, bool signedValue, uint32_t base) {
+	char* ptr = end;
+
+	if ((value < 0) && signedValue) {
+		value = -value; // Overflows for INT64_MIN, so that is left out of the test values.
+	}
+	do {
+		*(--ptr) = SerialAsciiTable[value % base];
+		value /= base;
+	} while (value > 0);
+	if (signedValue && ptr != end) {
+		*(--ptr) = '-'; // Same amount of work as the sign in the new routine.
+	}
+	return ptr;
+}
+
+static void benchLegacyPrintf(SerialStream* stream, const char* format, ...) {
+	va_list arg;
+	va_start(arg, format);
+	char cc;
+
+	while ((cc = *(format++))) {
+		if (cc != '%') {
+			stream->Write(cc);
+			continue;
+		}
+		switch ((cc = *(format++))) {
+			case 0: format--; break;
+			case 's': for (const char* text = va_arg(arg, char*); *text; text++) stream->Write(*text); break;
+			case 'd': benchLegacyPrintNum(stream, va_arg(arg, int), true, 10, 0); break;
+			case 'x': stream->Write('0'); stream->Write('x'); benchLegacyPrintNum(stream, va_arg(arg, unsigned int), false, 16, 0); break;
+			default: break;
+		}
+	}
+	va_end(arg);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Timing and reporting:
+
+static uint64_t benchNow(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void benchReport(const char* name, uint64_t ops, uint64_t bytes, uint64_t elapsed_ns) {
+	double ns_per_op = (double)elapsed_ns / ops;
+	double bytes_per_s = bytes ? (double)bytes * 1e9 / elapsed_ns : 0;
+	printf("{\"bench\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.2f, \"bytes_per_s\": %.0f}\n",
+		name, (unsigned long long)ops, ns_per_op, bytes_per_s);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Byte streaming through CircBuf_c:
+
+static void benchCircBufPerElement(uint32_t rounds) {
+	static CircBuf_c<uint8_t, 256> buf;
+	uint32_t sum = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		for (uint32_t j = 0; j < 128; j++) {
+			buf.Push(j);
+		}
+		while (buf.Available()) {
+			sum += buf.Pop();
+		}
+	}
+	benchReport("circbuf_push_pop_per_element", (uint64_t)rounds * 128, (uint64_t)rounds * 128, benchNow() - start);
+	benchSink = sum;
+}
+
+static void benchCircBufBulk(uint32_t rounds) {
+	static CircBuf_c<uint8_t, 256> buf;
+	uint8_t block[128];
+	uint32_t sum = 0;
+
+	for (uint32_t j = 0; j < sizeof(block); j++) {
+		block[j] = j;
+	}
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		buf.PushN(block, sizeof(block));
+		sum += buf.PopN(block, sizeof(block));
+	}
+	benchReport("circbuf_pushn_popn_128", (uint64_t)rounds * sizeof(block), (uint64_t)rounds * sizeof(block), benchNow() - start);
+	benchSink = sum;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Formatting, as used for log lines:
+
+static void benchPrintfLogLine(benchStream_c* stream, uint32_t rounds) {
+	stream->txCount = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		stream->printf("t=%d ch=%d adc=%d flags=%x state=%s\n", i, i & 15, 2048 - (int)(i & 4095), i * 2654435761U, "RUN");
+		stream->Drain();
+	}
+	benchReport("serial_printf_log_line", rounds, stream->txCount, benchNow() - start);
+}
+
+static void benchPrintfLogLineLegacy(benchStream_c* stream, uint32_t rounds) {
+	stream->txCount = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		benchLegacyPrintf(stream, "t=%d ch=%d adc=%d flags=%x state=%s\n", i, i & 15, 2048 - (int)(i & 4095), i * 2654435761U, "RUN");
+		stream->Drain();
+	}
+	benchReport("serial_printf_log_line_per_char", rounds, stream->txCount, benchNow() - start);
+}
+
+static void benchPrintLogLine(benchStream_c* stream, uint32_t rounds) {
+	stream->txCount = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		SERIAL_PRINT(*stream, "t=%d ch=%d adc=%d flags=%x state=%s\n", i, i & 15, 2048 - (int)(i & 4095), i * 2654435761U, "RUN");
+		stream->Drain();
+	}
+	benchReport("serial_print_log_line", rounds, stream->txCount, benchNow() - start);
+}
+
+static void benchSnprintfLogLine(uint32_t rounds) {
+	char line[SERIAL_PRINTF_BUFF_LENGTH];
+	uint64_t chars = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		chars += SerialStream::snprintf(line, sizeof(line), "t=%d ch=%d adc=%d flags=%x state=%s\n", i, i & 15, 2048 - (int)(i & 4095), i * 2654435761U, "RUN");
+	}
+	benchReport("serial_snprintf_log_line", rounds, chars, benchNow() - start);
+	benchSink = line[0];
+}
+
+static void benchSnprintfUnits(uint32_t rounds) {
+	char line[SERIAL_PRINTF_BUFF_LENGTH];
+	uint64_t chars = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		chars += SerialStream::snprintf(line, sizeof(line), "T=%.2f V=%.3f I=%.1q\n", 20.0 + (i & 255) * 0.01, 3.3 - (i & 1023) * 0.0001, (int)(i & 0x7fff));
+	}
+	benchReport("serial_snprintf_units", rounds, chars, benchNow() - start);
+	benchSink = line[0];
+}
+
+static void benchPrintNum(benchStream_c* stream, uint32_t rounds) {
+	stream->txCount = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		stream->BenchPrintNum((int64_t)(i * 2654435761U) - 2000000000);
+		if ((i & 63) == 63) {
+			stream->Drain();
+		}
+	}
+	benchReport("serial_printnum_dec", rounds, stream->txCount, benchNow() - start);
+	stream->Drain();
+}
+
+
+//Integer to ascii, old routine against new, over a spread of values:
+typedef char* (*benchNumToAscii_t)(char* end, int64_t value, bool signedValue, uint32_t base);
+
+static void benchNumToAscii(const char* name, benchNumToAscii_t convert, uint32_t base, bool wide, uint32_t rounds) {
+	int64_t values[256];
+	char buff[72];
+	uint64_t chars = 0;
+	uint64_t seed = 1;
+
+	for (uint32_t j = 0; j < 256; j++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		values[j] = wide ? (int64_t)(seed >> (1 + (j & 31))) : (int64_t)(seed >> (33 + (j & 31)));
+		values[j] = ((j & 1) && base == 10) ? -values[j] : values[j]; // Signed for decimal only.
+	}
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		for (uint32_t j = 0; j < 256; j++) {
+			chars += buff + sizeof(buff) - convert(buff + sizeof(buff), values[j], base == 10, base);
+		}
+	}
+	benchReport(name, (uint64_t)rounds * 256, chars, benchNow() - start);
+	benchSink = buff[sizeof(buff) - 1];
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Parsing, as used for commands:
+
+static void benchReadNumCommand(benchStream_c* stream, uint32_t rounds) {
+	static const char command[] = "SET 1234 -567 89012\n";
+	int64_t sum = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		stream->Feed(command);
+		sum += stream->BenchReadNum(10);
+		sum += stream->BenchReadNum(10);
+		sum += stream->BenchReadNum(10);
+		while (stream->Available()) {
+			stream->Read(); // Trailing newline.
+		}
+	}
+	benchReport("serial_readnum_command", rounds, (uint64_t)rounds * (sizeof(command) - 1), benchNow() - start);
+	benchSink = (uint32_t)sum;
+}
+
+static void benchReadStrLine(benchStream_c* stream, uint32_t rounds) {
+	static const char command[] = "SET 1234 -567 89012\n";
+	char line[64];
+	uint32_t sum = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		stream->Feed(command);
+		sum += stream->ReadStr(line) + line[4];
+	}
+	benchReport("serial_readstr_line", rounds, (uint64_t)rounds * (sizeof(command) - 1), benchNow() - start);
+	benchSink = sum;
+}
+
+static void benchLineGet(benchStream_c* stream, uint32_t rounds) {
+	static const char command[] = "SET 1234 -567 89012\n";
+	serialLine_t line;
+	uint32_t sum = 0;
+
+	stream->lineState.delimiter = '\n';
+	stream->lineState.maxLength = 80;
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		stream->Feed(command);
+		if (stream->LineGet(&line)) {
+			sum += line.length + line.span[0][4];
+			stream->LineRelease();
+		}
+	}
+	benchReport("serial_lineget_line", rounds, (uint64_t)rounds * (sizeof(command) - 1), benchNow() - start);
+	benchSink = sum;
+}
+
+static void benchParserCommand(benchStream_c* stream, uint32_t rounds) {
+	static const char command[] = "SET 1234 -567 89012\n";
+	static serialParser_c parser("SET %d %d %d\n");
+	int64_t sum = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		stream->Feed(command);
+		while (parser.Poll(stream) == serial_parseField);
+		sum += parser.Value(0) + parser.Value(1) + parser.Value(2);
+		parser.Reset();
+	}
+	benchReport("serial_parser_command", rounds, (uint64_t)rounds * (sizeof(command) - 1), benchNow() - start);
+	benchSink = (uint32_t)sum;
+}
+
+static void benchScanfCommand(benchStream_c* stream, uint32_t rounds) {
+	static const char command[] = "PWM 3 1500\n";
+	int channel, duty;
+	int64_t sum = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		stream->Feed(command);
+		stream->scanf("PWM %d %d", &channel, &duty);
+		sum += channel + duty;
+		while (stream->Available()) {
+			stream->Read();
+		}
+	}
+	benchReport("serial_scanf_command", rounds, (uint64_t)rounds * (sizeof(command) - 1), benchNow() - start);
+	benchSink = (uint32_t)sum;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Command dispatch, 32 commands: table lookup against a strcmp chain.
+
+static uint32_t benchCommandCount;
+static void benchCommand(serialShell_c*) { benchCommandCount++; }
+
+constexpr serialCommand_t benchCommands[] = {
+	{"adc", benchCommand, NULL},
+	{"baud", benchCommand, NULL},
+	{"boot", benchCommand, NULL},
+	{"can", benchCommand, NULL},
+	{"clock", benchCommand, NULL},
+	{"dac", benchCommand, NULL},
+	{"dump", benchCommand, NULL},
+	{"echo", benchCommand, NULL},
+	{"erase", benchCommand, NULL},
+	{"flash", benchCommand, NULL},
+	{"gpio", benchCommand, NULL},
+	{"help2", benchCommand, NULL},
+	{"i2c", benchCommand, NULL},
+	{"id", benchCommand, NULL},
+	{"led", benchCommand, NULL},
+	{"log", benchCommand, NULL},
+	{"mem", benchCommand, NULL},
+	{"mode", benchCommand, NULL},
+	{"peek", benchCommand, NULL},
+	{"poke", benchCommand, NULL},
+	{"pwm", benchCommand, NULL},
+	{"read", benchCommand, NULL},
+	{"reset", benchCommand, NULL},
+	{"rtc", benchCommand, NULL},
+	{"servo", benchCommand, NULL},
+	{"sleep", benchCommand, NULL},
+	{"spi", benchCommand, NULL},
+	{"stats", benchCommand, NULL},
+	{"temp", benchCommand, NULL},
+	{"uart", benchCommand, NULL},
+	{"version", benchCommand, NULL},
+	{"write", benchCommand, NULL},
+};
+SERIAL_SHELL_CHECK(benchCommands);
+
+static void benchStrcmpChain(const char* name) {
+	if (strcmp(name, "adc") == 0) benchCommand(NULL);
+	else if (strcmp(name, "baud") == 0) benchCommand(NULL);
+	else if (strcmp(name, "boot") == 0) benchCommand(NULL);
+	else if (strcmp(name, "can") == 0) benchCommand(NULL);
+	else if (strcmp(name, "clock") == 0) benchCommand(NULL);
+	else if (strcmp(name, "dac") == 0) benchCommand(NULL);
+	else if (strcmp(name, "dump") == 0) benchCommand(NULL);
+	else if (strcmp(name, "echo") == 0) benchCommand(NULL);
+	else if (strcmp(name, "erase") == 0) benchCommand(NULL);
+	else if (strcmp(name, "flash") == 0) benchCommand(NULL);
+	else if (strcmp(name, "gpio") == 0) benchCommand(NULL);
+	else if (strcmp(name, "help2") == 0) benchCommand(NULL);
+	else if (strcmp(name, "i2c") == 0) benchCommand(NULL);
+	else if (strcmp(name, "id") == 0) benchCommand(NULL);
+	else if (strcmp(name, "led") == 0) benchCommand(NULL);
+	else if (strcmp(name, "log") == 0) benchCommand(NULL);
+	else if (strcmp(name, "mem") == 0) benchCommand(NULL);
+	else if (strcmp(name, "mode") == 0) benchCommand(NULL);
+	else if (strcmp(name, "peek") == 0) benchCommand(NULL);
+	else if (strcmp(name, "poke") == 0) benchCommand(NULL);
+	else if (strcmp(name, "pwm") == 0) benchCommand(NULL);
+	else if (strcmp(name, "read") == 0) benchCommand(NULL);
+	else if (strcmp(name, "reset") == 0) benchCommand(NULL);
+	else if (strcmp(name, "rtc") == 0) benchCommand(NULL);
+	else if (strcmp(name, "servo") == 0) benchCommand(NULL);
+	else if (strcmp(name, "sleep") == 0) benchCommand(NULL);
+	else if (strcmp(name, "spi") == 0) benchCommand(NULL);
+	else if (strcmp(name, "stats") == 0) benchCommand(NULL);
+	else if (strcmp(name, "temp") == 0) benchCommand(NULL);
+	else if (strcmp(name, "uart") == 0) benchCommand(NULL);
+	else if (strcmp(name, "version") == 0) benchCommand(NULL);
+	else if (strcmp(name, "write") == 0) benchCommand(NULL);
+}
+
+static void benchShellDispatch(uint32_t rounds) {
+	static serialShell_c shell(benchCommands, sizeof(benchCommands) / sizeof(benchCommands[0]));
+	static const char* lines[] = {"adc 3", "pwm 1 1500", "version", "write 0x20000000 0xFF"};
+	char line[SERIAL_SHELL_LINE_LENGTH + 1];
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		const char* text = lines[i & 3];
+		uint32_t length = strlen(text);
+		memcpy(line, text, length);
+		shell.Execute(line, length, NULL);
+	}
+	benchReport("serial_shell_dispatch", rounds, 0, benchNow() - start);
+	benchSink = benchCommandCount;
+}
+
+static void benchStrcmpDispatch(uint32_t rounds) {
+	static const char* lines[] = {"adc 3", "pwm 1 1500", "version", "write 0x20000000 0xFF"};
+	char line[SERIAL_SHELL_LINE_LENGTH + 1];
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		const char* text = lines[i & 3];
+		uint32_t length = strlen(text);
+		memcpy(line, text, length + 1);
+		char* space = strchr(line, ' ');
+		if (space) {
+			*space = '\0';
+		}
+		benchStrcmpChain(line);
+	}
+	benchReport("serial_strcmp_dispatch", rounds, 0, benchNow() - start);
+	benchSink = benchCommandCount;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Binary packets: CRCs, and a COBS + CRC-16 packet sent and decoded.
+
+static void benchCRC(uint32_t rounds) {
+	static uint8_t data[256];
+	uint32_t sum = 0;
+
+	for (uint32_t i = 0; i < sizeof(data); i++) {
+		data[i] = i * 7;
+	}
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		data[0] = i;
+		sum += serialCRC16(data, sizeof(data));
+	}
+	benchReport("crc16_256_bytes", rounds, (uint64_t)rounds * sizeof(data), benchNow() - start);
+
+	start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		data[0] = i;
+		sum += serialCRC32(data, sizeof(data));
+	}
+	benchReport("crc32_256_bytes", rounds, (uint64_t)rounds * sizeof(data), benchNow() - start);
+	benchSink = sum;
+}
+
+static uint32_t benchPacketBytes;
+static void benchPacketHandler(void*, const uint8_t*, uint32_t length) { benchPacketBytes += length; }
+
+static void benchPacketLoopback(benchStream_c* stream, uint32_t rounds) {
+	static serialPacket_c sender(stream, serial_packetCOBS, serial_packetCRC16, NULL, NULL);
+	static serialPacket_c receiver(stream, serial_packetCOBS, serial_packetCRC16, benchPacketHandler, NULL);
+	uint8_t telemetry[64];
+	uint8_t wire[128];
+
+	for (uint32_t i = 0; i < sizeof(telemetry); i++) {
+		telemetry[i] = (i % 5) ? i : 0; // Some zeros for COBS to remove.
+	}
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		telemetry[1] = i;
+		sender.Send(telemetry, sizeof(telemetry));
+		receiver.Receive(wire, stream->TakeWritten(wire, sizeof(wire)));
+	}
+	benchReport("serial_packet_cobs_crc16_64", rounds, (uint64_t)rounds * sizeof(telemetry), benchNow() - start);
+	benchSink = benchPacketBytes;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Arduino helpers, as used for sensor scaling:
+
+static void benchArduMapConstrain(uint32_t rounds) {
+	int32_t sum = 0;
+
+	uint64_t start = benchNow();
+	for (uint32_t i = 0; i < rounds; i++) {
+		int32_t raw = (int32_t)(i & 4095);
+		sum += ardu_constrain(ardu_map(raw, (int32_t)0, (int32_t)4095, (int32_t)-1000, (int32_t)1000), (int32_t)-900, (int32_t)900);
+	}
+	benchReport("ardu_map_constrain_int32", rounds, 0, benchNow() - start);
+	benchSink = (uint32_t)sum;
+}
+
+
+int main(void) {
+	static benchStream_c stream;
+
+	benchCircBufPerElement(200000);
+	benchCircBufBulk(200000);
+	benchPrintfLogLineLegacy(&stream, 200000);
+	benchPrintfLogLine(&stream, 200000);
+	benchPrintLogLine(&stream, 200000);
+	benchSnprintfLogLine(200000);
+	benchSnprintfUnits(200000);
+	benchPrintNum(&stream, 1000000);
+	benchNumToAscii("itoa_legacy_dec32", benchLegacyNumToAscii, 10, false, 4000);
+	benchNumToAscii("itoa_dec32", benchStream_c::BenchNumToAscii, 10, false, 4000);
+	benchNumToAscii("itoa_legacy_dec64", benchLegacyNumToAscii, 10, true, 4000);
+	benchNumToAscii("itoa_dec64", benchStream_c::BenchNumToAscii, 10, true, 4000);
+	benchNumToAscii("itoa_legacy_hex32", benchLegacyNumToAscii, 16, false, 4000);
+	benchNumToAscii("itoa_hex32", benchStream_c::BenchNumToAscii, 16, false, 4000);
+	benchReadNumCommand(&stream, 200000);
+	benchParserCommand(&stream, 200000);
+	benchReadStrLine(&stream, 200000);
+	benchLineGet(&stream, 200000);
+	benchScanfCommand(&stream, 200000);
+	benchStrcmpDispatch(1000000);
+	benchShellDispatch(1000000);
+	benchCRC(100000);
+	benchPacketLoopback(&stream, 200000);
+	benchArduMapConstrain(10000000);
+
+	return 0;
+}
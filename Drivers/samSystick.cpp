@@ -15,7 +15,7 @@ void samSysTick_c::Begin(uint32_t sysTickFrequency) {
 	SysTick->CTRL = 0; // Disable temporarily, if running
 	
 	uint32_t ticks = samClock.MasterFreqGet() / (8 * sysTickFrequency); // SAM4 provides reference clock at MCK/8.
-	ticks = ardu_constrain(ticks, 1UL, 1UL << 24);
+	ticks = ardu_constrain(ticks, (uint32_t)1, (uint32_t)1 << 24);
 	
 	SysTick->LOAD = ticks - 1; // Load value. Note flag set when counting 1->0, so -1 ticks.
 	SysTick->VAL = 0; // Reset counter
@@ -27,7 +27,7 @@ void samSysTick_c::Begin(uint32_t sysTickFrequency) {
 void samSysTick_c::FreqSet(uint32_t sysTickFrequency) {
 	//Changes systick frequency without resetting counter.
 	uint32_t ticks = samClock.MasterFreqGet() / (8 * sysTickFrequency); // SAM4 provides reference clock at MCK/8.
-	ticks = ardu_constrain(ticks, 1UL, 1UL << 24);
+	ticks = ardu_constrain(ticks, (uint32_t)1, (uint32_t)1 << 24);
 	SysTick->LOAD = ticks - 1; // Load value. Note flag set when counting 1->0, so -1 ticks.
 }
 
@@ -46,6 +46,31 @@ void samSysTick_c::Wait(void) {
 }
 
 
+sysTickTimeout_c::sysTickTimeout_c(uint32_t time_us) {
+	//Converts time to reference clock ticks and notes where the counter is.
+	this->remaining = ((uint64_t)time_us * (samClock.MasterFreqGet() / 8)) / 1000000;
+	this->lastCount = SysTick->VAL;
+}
+
+bool sysTickTimeout_c::Expired(void) {
+	//Counts down remaining time by however far SysTick has moved since last call.
+	uint32_t count = SysTick->VAL;
+	uint32_t elapsed = this->lastCount - count;
+	
+	if (count > this->lastCount) { // Counter reloaded since last call.
+		elapsed += SysTick->LOAD + 1;
+	}
+	this->lastCount = count;
+	
+	if (elapsed >= this->remaining) {
+		this->remaining = 0;
+		return true;
+	}
+	this->remaining -= elapsed;
+	return false;
+}
+
+
 // Global definition:
 samSysTick_c samSysTick;
 
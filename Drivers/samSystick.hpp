@@ -28,6 +28,20 @@ class samSysTick_c {
 		void Wait(void);
 };
 
+
+//Timeout for sleeping (WFI) waits, measured from the SysTick counter. 
+// Needs samSysTick running: its interrupt guarantees Expired() is checked 
+// at least once per SysTick period, so counter wraps are never missed.
+class sysTickTimeout_c {
+	public:
+		sysTickTimeout_c(uint32_t time_us);
+		bool Expired(void);
+	
+	private:
+		uint32_t remaining; // In SysTick reference clock ticks (MCK/8).
+		uint32_t lastCount;
+};
+
 #include "samSystick.cpp"
 
 //Global declaration:
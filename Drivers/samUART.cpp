@@ -7,11 +7,13 @@
 
 #include "sam.h"
 #include "samClock.hpp"
+#include "../Utilities/arduino-funcs.hpp"
 #include "../Utilities/CircBuf.hpp"
 
 
-samUART_c::samUART_c(int id) : channel_id(id)
+samUART_c::samUART_c(int id) : channel_id(id), txInFlight(0), lineState(), stats(), baudActual(0), baudError(0)
 {
+	this->LineConfig('\n', UART_BUFF_LENGTH - 1);
 	if (this->channel_id) {
 		this->base_id = UART1;
 	}
@@ -20,23 +22,46 @@ samUART_c::samUART_c(int id) : channel_id(id)
 	}
 }
 
-void samUART_c::Begin(uint32_t baud, uint32_t parity) 
+#ifdef SAM4LIB_HOST_TEST
+samUART_c::samUART_c(int id, Uart* registers) : samUART_c(id)
+{
+	this->base_id = registers;
+}
+#endif
+
+bool samUART_c::Begin(uint32_t baud, uint32_t parity) 
 {
 	//Initialise UART, with given data parameters.
 	
+	//Enable peripheral clock first, so the register writes below take effect:
+	samClock.PeriphClockEnable(ID_UART0 + samUART_c::channel_id);
+	
 	//Reset and disable interrupts::
 	this->base_id->UART_CR = UART_CR_RSTRX | UART_CR_RSTTX | UART_CR_RXDIS | UART_CR_TXDIS;
-	this->base_id->UART_IDR = ~0UL;
+	this->base_id->UART_IDR = 0xFFFFFFFF;
 	
-	//Enable peripheral clock:
-	samClock.PeriphClockEnable(ID_UART0 + samUART_c::channel_id);
+	//Baud rate generator: 16x oversampling, whole divider only - rounded to nearest.
+	// Refuse rates the other end may not tolerate.
+	uint32_t clock = samClock.MasterFreqGet();
+	uint32_t baudDivider = ardu_constrain((clock + 8 * baud) / (16 * baud), (uint32_t)1, (uint32_t)0xffff);
+	this->baudActual = (clock + 8 * baudDivider) / (16 * baudDivider);
+	this->baudError = ((int64_t)this->baudActual - baud) * 1000000 / (int64_t)baud;
+	if (this->baudError > UART_BAUD_TOLERANCE_PPM || this->baudError < -UART_BAUD_TOLERANCE_PPM) {
+		return false;
+	}
 	
 	//Set up UART:
 	this->base_id->UART_MR = UART_MR_PAR(parity) | UART_MR_CHMODE(UART_MR_CHMODE_NORMAL);
-	//Set up baud rate generator:
-	uint16_t baudDivider = samClock.MasterFreqGet() / (16 * (uint64_t)baud);
 	this->base_id->UART_BRGR = UART_BRGR_CD(baudDivider);
 	
+	//Transmit goes through the PDC. Counters are zero, so nothing is sent until loaded.
+	this->base_id->UART_PTCR = UART_PTCR_TXTDIS | UART_PTCR_RXTDIS;
+	this->base_id->UART_TCR = 0;
+	this->base_id->UART_TNCR = 0;
+	this->transmitBuffer.CommitRead(this->txInFlight); // Drop anything in flight before reset.
+	this->txInFlight = 0;
+	this->base_id->UART_PTCR = UART_PTCR_TXTEN;
+	
 	//Set up and enable interrupts:
 	this->base_id->UART_IER = UART_IER_RXRDY; // Enable receive interrupts - transmit enabled when necessary.
 	if (this->channel_id)
@@ -46,6 +71,15 @@ void samUART_c::Begin(uint32_t baud, uint32_t parity)
 	
 	//Enable RX and TX:
 	this->base_id->UART_CR |= UART_CR_RXEN | UART_CR_TXEN;
+	return true;
+}
+
+//Achieved baud rate from the last Begin, and its error from the request.
+uint32_t samUART_c::BaudGet(void) {
+	return this->baudActual;
+}
+int32_t samUART_c::BaudErrorPPM(void) {
+	return this->baudError;
 }
 
 //Returns number of bytes available to read.
@@ -55,8 +89,46 @@ uint32_t samUART_c::Available(void) {
 //Write a byte into internal buffer.
 void samUART_c::Write(uint8_t byte) {
 	this->transmitBuffer.Push(byte);
-	//Enable transmit interrupts, to call update function.
-	this->base_id->UART_IER = UART_IER_TXRDY;
+	//Enable PDC buffer-empty interrupt, to call update function when idle.
+	this->base_id->UART_IER = UART_IER_TXBUFE;
+}
+//Write a block of bytes into internal buffer.
+uint32_t samUART_c::WriteBlock(const uint8_t* data, uint32_t num_bytes) {
+	uint32_t accepted = this->transmitBuffer.PushN(data, num_bytes);
+	this->base_id->UART_IER = UART_IER_TXBUFE;
+	return accepted;
+}
+//Free space in internal transmit buffer.
+uint32_t samUART_c::WriteSpace(void) {
+	return this->transmitBuffer.Space();
+}
+//Write a block, sleeping until there is room for all of it or timeout.
+uint32_t samUART_c::WriteWait(const uint8_t* data, uint32_t num_bytes, uint32_t timeout_us) {
+	sysTickTimeout_c timeout(timeout_us);
+	uint32_t sent = this->WriteBlock(data, num_bytes);
+	
+	// Buffer is full, so a transmit interrupt is always still to come to wake us.
+	while (sent < num_bytes && !timeout.Expired()) {
+		__WFI();
+		sent += this->WriteBlock(data + sent, num_bytes - sent);
+	}
+	return sent;
+}
+//Reads up to num_bytes from the internal buffer, returns number read.
+uint32_t samUART_c::ReadBlock(uint8_t* data, uint32_t num_bytes) {
+	return this->recieveBuffer.PopN(data, num_bytes);
+}
+//Line framing: the search and release are shared with the USART driver.
+void samUART_c::LineConfig(uint8_t delimiter, uint32_t maxLength) {
+	this->lineState.delimiter = delimiter;
+	this->lineState.maxLength = (maxLength < UART_BUFF_LENGTH) ? maxLength : UART_BUFF_LENGTH - 1;
+	this->lineState.scanned = 0;
+}
+bool samUART_c::LineGet(serialLine_t* line) {
+	return serialLineGet(&this->recieveBuffer, &this->lineState, line);
+}
+bool samUART_c::LineRelease(void) {
+	return serialLineRelease(&this->recieveBuffer, &this->lineState);
 }
 //Returns a byte from the internal buffer.
 int16_t samUART_c::Read(void) {
@@ -84,13 +156,25 @@ int16_t samUART_c::uartRead(void)
 {
 	//Gets a byte from the receive register.
 	
+	uint32_t status = this->base_id->UART_SR;
 	int16_t character = this->base_id->UART_RHR & 0xff;
 	
-	if (this->base_id->UART_SR & (UART_SR_PARE | UART_SR_FRAME)) {//If error detected.
-		character = -1; // Error code.
+	if (status & (UART_SR_OVRE | UART_SR_PARE | UART_SR_FRAME)) {
+		// Overrun lost an earlier byte, but this one is still good.
+		if (status & UART_SR_OVRE) {
+			this->stats.overrunErrors++;
+		}
+		if (status & UART_SR_FRAME) {
+			this->stats.framingErrors++;
+			character = -1; // Error code.
+		}
+		if (status & UART_SR_PARE) {
+			this->stats.parityErrors++;
+			character = -1;
+		}
+		//Reset error flags:
+		this->base_id->UART_CR = UART_CR_RSTSTA;
 	}
-	//Reset error flags:
-	this->base_id->UART_CR |= UART_CR_RSTSTA;
 	
 	return character;
 }
@@ -107,23 +191,70 @@ void samUART_c::uartWrite(uint8_t byte)
 
 
 
-void samUART_c::Update(void) 
+void samUART_c::txDMAUpdate(void) 
 {
-	//Updates UART, depending on read-ready, write-ready, etc.
+	//Called once the PDC has sent everything it was given.
+	uint32_t length, wrapLength;
+	
+	this->transmitBuffer.CommitRead(this->txInFlight);
+	this->stats.bytesOut += this->txInFlight;
+	this->txInFlight = 0;
 	
-	if (this->transmitBuffer.Available() > 0 && this->uartWriteReady()) {
-		this->uartWrite(this->transmitBuffer.Pop());
+	uint8_t* chunk = this->transmitBuffer.ReadRegion(&length);
+	if (length == 0) {
+		// Don't want spontaneous interrupts. Check again afterwards, in case
+		//  Write() re-enabled them just before we disabled them.
+		this->base_id->UART_IDR = UART_IDR_TXBUFE;
+		chunk = this->transmitBuffer.ReadRegion(&length);
+		if (length == 0) {
+			return;
+		}
+		this->base_id->UART_IER = UART_IER_TXBUFE;
 	}
-	else { // Don't want spontaneous interrupts.
-		this->base_id->UART_IDR = UART_IER_TXRDY;
+	
+	//First segment runs to the end of the ring, second is the wrapped part.
+	uint8_t* wrapChunk = this->transmitBuffer.ReadRegion(&wrapLength, length);
+	
+	this->base_id->UART_TPR = (uint32_t)(uintptr_t)chunk;
+	this->base_id->UART_TCR = length;
+	this->base_id->UART_TNPR = (uint32_t)(uintptr_t)wrapChunk;
+	this->base_id->UART_TNCR = wrapLength;
+	this->txInFlight = length + wrapLength;
+}
+
+
+void samUART_c::Update(void) 
+{
+	//Updates UART, depending on read-ready, PDC transmit done, etc.
+	
+	if ((this->base_id->UART_IMR & UART_IMR_TXBUFE) && (this->base_id->UART_SR & UART_SR_TXBUFE)) {
+		this->txDMAUpdate();
 	}
 	
 	if (this->uartReadReady()) {
-		uint16_t character = this->uartRead();
+		int16_t character = this->uartRead();
 		if (character >= 0) { // No error detected.
 			this->recieveBuffer.Push(character);
+			this->stats.bytesIn++;
 		}
 	}
+	
+	this->stats.interrupts++;
+}
+
+
+serialStats_t samUART_c::StatsGet(void) 
+{
+	//Snapshot of counters, plus buffer drop and peak figures.
+	serialStats_t snapshot = this->stats;
+	
+	snapshot.rxDrops = this->recieveBuffer.DroppedCount();
+	snapshot.txDrops = this->transmitBuffer.DroppedCount();
+	snapshot.rxPeak = this->recieveBuffer.HighWaterMark();
+	snapshot.txPeak = this->transmitBuffer.HighWaterMark();
+	snapshot.linesDiscarded = this->lineState.discarded;
+	snapshot.linesOverrun = this->lineState.overrun;
+	return snapshot;
 }
 
 
@@ -10,17 +10,20 @@
 #define SAMUART_HPP_
 
 #include "sam.h"
+#include "samSystick.hpp"
 #include "../Utilities/CircBuf.hpp"
 #include "../Utilities/serial-funcs.hpp"
 
 #define UART_BUFF_LENGTH 256
+#define UART_BAUD_TOLERANCE_PPM 20000 // Baud rates further off than this are refused by Begin.
 
 enum {uart_parityEven, uart_parityOdd, uart_parityMark, uart_paritySpace, uart_parityNone};
 
 class samUART_c: public SerialStream {
 	public:
-		//Initialiser - baud rate, parity.
-		void Begin(uint32_t baud, uint32_t parity);
+		//Initialiser - baud rate, parity. Returns false, leaving the UART off, if the 
+		// rate can't be made within UART_BAUD_TOLERANCE_PPM (the UART has no fractional divider).
+		bool Begin(uint32_t baud, uint32_t parity);
 		
 		//Access internal buffer to send/recieve bytes. 
 		// I recommend using the functions in the SerialStream class instead!
@@ -29,11 +32,45 @@ class samUART_c: public SerialStream {
 		int16_t Peek(void); // Same as read but doesn't consume data.
 		void Write(uint8_t byte); // Write a byte to the internal buffer
 		
+		//Block versions - one buffer operation and one interrupt enable per block.
+		// WriteBlock returns how many bytes fitted; the rest are not sent.
+		uint32_t WriteBlock(const uint8_t* data, uint32_t num_bytes);
+		uint32_t ReadBlock(uint8_t* data, uint32_t num_bytes);
+		
+		//Backpressure: free space in transmit buffer, and a write that sleeps 
+		// until everything is accepted or timeout_us passes (needs samSysTick 
+		// running). Returns bytes accepted.
+		uint32_t WriteSpace(void);
+		uint32_t WriteWait(const uint8_t* data, uint32_t num_bytes, uint32_t timeout_us);
+		
+		//Line framing in place: LineGet returns true with the next complete line 
+		// as pointers into the receive buffer (nothing is copied), to be handed 
+		// back with LineRelease. Lines longer than maxLength (at most the buffer 
+		// length - 1) are dropped whole and counted in StatsGet(). Defaults to 
+		// '\n' and the longest line that fits. Avoid Read() etc. while lines are in use.
+		//The receive buffer overwrites its oldest bytes when full, so a line held 
+		// while it fills is lost: LineRelease then returns false (and counts it in 
+		// StatsGet()), and what was read from the line can't be trusted.
+		void LineConfig(uint8_t delimiter, uint32_t maxLength);
+		bool LineGet(serialLine_t* line);
+		bool LineRelease(void);
+		
+		
+		//Link statistics: byte and error counts, buffer drops and peaks.
+		serialStats_t StatsGet(void);
+		
+		//Achieved baud rate from the last Begin, and its error in parts per million.
+		uint32_t BaudGet(void);
+		int32_t BaudErrorPPM(void);
 		
 		//Updater - called as interrupt handler, but can be polled also.
 		void Update(void);
 		//constructor - one instance for UART0 and UART1.
 		samUART_c(int id);
+#ifdef SAM4LIB_HOST_TEST
+		//Host tests drive the UART through a simulated register block instead.
+		samUART_c(int id, Uart* registers);
+#endif
 		
 	private:
 		bool uartWriteReady(void);
@@ -41,10 +78,21 @@ class samUART_c: public SerialStream {
 		int16_t uartRead(void);
 		bool uartReadReady(void);
 		
+		//Hands the next contiguous chunk(s) of transmitBuffer to the PDC.
+		void txDMAUpdate(void);
+		
 		bool channel_id; // Channel can be 0 or 1 on SAM4S.
 		Uart* base_id; // Base address for peripheral.
-		CircBuf_c<uint8_t, UART_BUFF_LENGTH> recieveBuffer;
-		CircBuf_c<uint8_t, UART_BUFF_LENGTH> transmitBuffer;
+		CircBuf_c<uint8_t, UART_BUFF_LENGTH, circbuf_overwriteOldest, true> recieveBuffer;
+		//The PDC reads straight out of transmitBuffer, so it must never be 
+		// overwritten - new bytes are dropped when it is full instead.
+		CircBuf_c<uint8_t, UART_BUFF_LENGTH, circbuf_dropNewest, true> transmitBuffer;
+		uint32_t txInFlight; // Bytes currently loaded into the PDC.
+		serialLineState_t lineState; // LineGet() progress through recieveBuffer.
+		
+		serialStats_t stats; // Counters kept by Update(); buffer figures filled in by StatsGet().
+		uint32_t baudActual;
+		int32_t baudError; // Parts per million.
 };
 
 #include "samUART.cpp"
@@ -7,26 +7,42 @@
  */ 
 
 #include "sam.h"
+#include "string.h"
 #include "samClock.hpp"
+#include "../Utilities/arduino-funcs.hpp"
 
 
 //Initialiser: sets up peripheral. Use bitwise OR for multiple options.
-void samUSART_c::Begin(uint32_t mode, uint32_t baud_clockrate, uint32_t parity, uint32_t options) {
+bool samUSART_c::Begin(uint32_t mode, uint32_t baud_clockrate, uint32_t parity, uint32_t options) {
+	
+	//Peripheral clock first, or none of the register writes below take effect:
+	samClock.PeriphClockEnable(this->ch_id ? ID_USART1 : ID_USART0);
 	
 	//Disable and reset:
-	this->base->US_IDR = ~0UL; // Disable all interrupts
+	this->base->US_IDR = 0xFFFFFFFF; // Disable all interrupts
 	this->base->US_MR = 0;
 	this->base->US_CR = US_CR_RSTRX | US_CR_RSTTX | US_CR_RXDIS | US_CR_TXDIS | US_CR_RSTSTA;
 	this->base->US_BRGR = 0;
+	this->base->US_PTCR = US_PTCR_RXTDIS | US_PTCR_TXTDIS;
+	this->rxDMAEnabled = false;
+	this->rxFlowControl = false;
+	this->frameHandler = NULL;
+	this->multidrop = false;
+	this->manchFrames = false;
+	this->mode = mode;
 	
 	
-	// note: Fractional clock divider available, but not used here.
-	uint32_t clockDivider = samClock.MasterFreqGet() / baud_clockrate; 
+	uint32_t clockDivider = 0; // Baud rate generator register value.
+	uint32_t sampling;
+	this->baudActual = 0;
 	
 	switch (mode) {
 		case usart_modeSerialAsync: // Set up to be a UART.
-			//Clock generator: need 16x oversampling from baudrate. Faster speeds => use synch mode.
-			clockDivider /= 16;
+			//Clock generator: 16x or 8x oversampling, with fractional divider. Faster speeds => use synch mode.
+			clockDivider = this->baudAsyncSelect(baud_clockrate, true, &sampling);
+			if (sampling == 8) {
+				this->base->US_MR |= US_MR_OVER;
+			}
 			
 			//Options:
 			if (options & usart_optionAsyncMSBFirst) {
@@ -35,6 +51,19 @@ void samUSART_c::Begin(uint32_t mode, uint32_t baud_clockrate, uint32_t parity,
 			if (options & usart_optionAsyncInvertData) {
 				this->base->US_MR |= US_MR_INVDATA;
 			}
+			if (options & usart_optionAsyncHandshaking) {
+				this->base->US_MR |= US_MR_USART_MODE_HW_HANDSHAKING;
+				this->rxFlowControl = true;
+			}
+			else if (options & usart_optionAsyncRS485) {
+				this->base->US_MR |= US_MR_USART_MODE_RS485;
+			}
+			if (parity == usart_parityMultidrop) {
+				this->multidrop = true;
+				this->multidropAccepting = true;
+				this->multidropAddress = -1;
+				this->multidropBroadcast = -1;
+			}
 			
 			//Mode register: Asynchronous, internal clock for all, 8-bit for UART.
 			this->base->US_MR |= US_MR_USART_MODE_NORMAL | US_MR_CHRL_8_BIT | US_MR_USCLKS_MCK | 
@@ -47,11 +76,12 @@ void samUSART_c::Begin(uint32_t mode, uint32_t baud_clockrate, uint32_t parity,
 			//Clock generator: Local at baudrate, or remote. 
 			if (options & usart_optionSynchClockRemote) {
 				this->base->US_MR |= US_MR_USCLKS_SCK; // Select external clock
-				clockDivider = 0; // Don't want local clock running.
+				// Don't want local clock running, and rate is up to the other end.
 			}
 			else {
-				// Select local clock and enable clock output.
+				// Select local clock and enable clock output. No fractional part in synchronous mode.
 				this->base->US_MR |= US_MR_USCLKS_MCK | US_MR_CLKO;
+				clockDivider = this->baudSyncSelect(baud_clockrate, 1);
 			}
 			
 			//Options:
@@ -71,14 +101,14 @@ void samUSART_c::Begin(uint32_t mode, uint32_t baud_clockrate, uint32_t parity,
 		case usart_modeManchester: // Manchester encoded signal (clockless).
 			uint32_t parameter;
 			
-			//Clock generator: use 16x oversampling, and drift compensation!
-			clockDivider /= 16;
-			this->base->US_MAN |= US_MAN_DRIFT | US_MAN_ONE;
+			//Clock generator: use 16x oversampling (needed for drift compensation), and drift compensation!
+			clockDivider = this->baudAsyncSelect(baud_clockrate, false, &sampling);
+			this->base->US_MAN = US_MAN_DRIFT | US_MAN_ONE;
 			
 			//Preamble:
-			parameter = (options & 0xf00) >> 2;
+			parameter = (options >> 8) & 0xf;
 			this->base->US_MAN |= US_MAN_TX_PL(parameter) | US_MAN_RX_PL(parameter);
-			parameter = (options & 0xf0) >> 1;
+			parameter = (options >> 4) & 0x3;
 			this->base->US_MAN |= US_MAN_TX_PP(parameter) | US_MAN_RX_PP(parameter);
 			
 			//Polarity:
@@ -92,37 +122,635 @@ void samUSART_c::Begin(uint32_t mode, uint32_t baud_clockrate, uint32_t parity,
 				US_MR_PAR(parity) | US_MR_NBSTOP_1_BIT | US_MR_MAN | US_MR_ONEBIT;
 			
 			break;
+		
+		case usart_modeSPIMaster: // SPI master, clock and chip select driven by us.
+			//Clock generator: SCK at or below baudrate, divider must be at least 6.
+			clockDivider = this->baudSyncSelect(baud_clockrate, 6);
+			
+			//Clock polarity and phase. Note the USART's CPHA is the inverse of the usual SPI CPHA.
+			if (!(options & 0x01)) {
+				this->base->US_MR |= US_MR_CPHA;
+			}
+			if (options & 0x02) {
+				this->base->US_MR |= US_MR_CPOL;
+			}
+			
+			//Mode register: SPI master, 8-bit, MSB first, clock output enabled.
+			this->base->US_MR |= US_MR_USART_MODE_SPI_MASTER | US_MR_CHRL_8_BIT | US_MR_USCLKS_MCK | US_MR_CLKO;
+			
+			this->spiCurrent = NULL;
+			break;
 			
 		default:
 			break; // Don't set up anything.
 	}
 	
-	//Baud rate generator and clock:
-	samClock.PeriphClockEnable(this->ch_id ? ID_USART1 : ID_USART0);
-	this->base->US_BRGR |= US_BRGR_CD(clockDivider);
+	//Refuse rates the receiver at the other end may not tolerate. Left disabled.
+	this->baudError = 0;
+	if (this->baudActual) {
+		this->baudError = ((int64_t)this->baudActual - baud_clockrate) * 1000000 / (int64_t)baud_clockrate;
+	}
+	if ((mode == usart_modeSerialAsync || mode == usart_modeManchester) && 
+		(this->baudActual == 0 || this->baudError > USART_BAUD_TOLERANCE_PPM || 
+		this->baudError < -USART_BAUD_TOLERANCE_PPM)) {
+		return false;
+	}
 	
-	//Set up and enable interrupts:
-	this->base->US_IER = US_IER_RXRDY; // Enable receive interrupts - transmit enabled when necessary.
+	//Baud rate generator:
+	this->base->US_BRGR = clockDivider;
+	
+	//Set up and enable interrupts (SPI transfers enable their own):
+	if (this->rxFlowControl) {
+		// RTS is only on while the PDC has receive space, so it must always be in use.
+		this->rxFlowLoaded = 0;
+		this->rxFlowHeld = false;
+		this->base->US_RTOR = US_RTOR_TO(USART_RX_FLOW_TIMEOUT);
+		this->base->US_CR = US_CR_STTTO;
+		this->base->US_IER = US_IER_TIMEOUT | US_IER_OVRE | US_IER_FRAME | US_IER_PARE;
+		this->rxFlowRefill();
+		this->base->US_PTCR = US_PTCR_RXTEN;
+	}
+	else if (mode != usart_modeSPIMaster) {
+		this->base->US_IER = US_IER_RXRDY | US_IER_OVRE | US_IER_FRAME | US_IER_PARE; // Enable receive and error interrupts - transmit enabled when necessary.
+		// In multidrop mode, PARE is the address byte interrupt.
+	}
 	NVIC_EnableIRQ(this->ch_id ? USART1_IRQn : USART0_IRQn); // Enable USART interrupts.
 	
 	//Enable Tx and Rx, reset any errors:
 	this->base->US_CR = US_CR_RXEN | US_CR_TXEN | US_CR_RSTSTA;
+	return true;
+}
+
+
+//Picks the divider (CD and FP, in eighths) and 16x or 8x oversampling giving the 
+// closest asynchronous rate. Returns the US_BRGR value, and sets baudActual.
+uint32_t samUSART_c::baudAsyncSelect(uint32_t baud, bool allow8x, uint32_t* sampling) {
+	uint64_t clock = (uint64_t)samClock.MasterFreqGet() * 8;
+	uint32_t best = 0;
+	uint32_t bestError = UINT32_MAX;
+	
+	*sampling = 16;
+	// 16x first, so it wins ties - it tolerates more noise and drift.
+	for (uint32_t over = 16; over >= (allow8x ? 8U : 16U); over /= 2) {
+		uint64_t step = (uint64_t)over * baud;
+		uint64_t divider = ardu_constrain((clock + step / 2) / step, (uint64_t)8, (uint64_t)0x7ffff); // CD 1 to 65535.
+		uint32_t actual = (clock + over * divider / 2) / (over * divider);
+		uint32_t error = (actual > baud) ? actual - baud : baud - actual;
+		
+		if (error < bestError) {
+			bestError = error;
+			best = US_BRGR_CD(divider / 8) | US_BRGR_FP(divider % 8);
+			*sampling = over;
+			this->baudActual = actual;
+		}
+	}
+	return best;
+}
+
+//Synchronous and SPI clocks: whole divider, rounded so the clock never exceeds rate.
+uint32_t samUSART_c::baudSyncSelect(uint32_t rate, uint32_t minimum) {
+	uint32_t clock = samClock.MasterFreqGet();
+	uint32_t divider = ardu_constrain((clock + rate - 1) / rate, minimum, (uint32_t)0xffff);
+	
+	this->baudActual = clock / divider;
+	return US_BRGR_CD(divider);
+}
+
+//Achieved baud rate (or clock rate) from the last Begin, and its error from the request.
+uint32_t samUSART_c::BaudGet(void) {
+	return this->baudActual;
+}
+int32_t samUSART_c::BaudErrorPPM(void) {
+	return this->baudError;
+}
+
+
+//Receive through PDC ping-pong buffers, with receiver time-out for partial buffers.
+void samUSART_c::RxDMAEnable(uint32_t timeout_bits) {
+	
+	if (this->rxFlowControl) { // Already receiving through the PDC.
+		this->base->US_RTOR = US_RTOR_TO(timeout_bits);
+		return;
+	}
+	if (this->multidrop) {
+		return; // Address filtering needs byte-wise receive.
+	}
+	
+	//Stop byte-wise receive interrupts:
+	this->base->US_IDR = US_IDR_RXRDY;
+	this->base->US_PTCR = US_PTCR_RXTDIS;
+	
+	//Load both buffers - PDC moves onto the next one by itself when current fills.
+	this->rxDMAIndex = 0;
+	this->rxDMAFlushed = 0;
+	this->base->US_RPR = (uint32_t)(uintptr_t)this->rxDMABuffer[0];
+	this->base->US_RCR = USART_RX_DMA_LENGTH;
+	this->base->US_RNPR = (uint32_t)(uintptr_t)this->rxDMABuffer[1];
+	this->base->US_RNCR = USART_RX_DMA_LENGTH;
+	this->rxDMAEnabled = true;
+	
+	//Time-out counts bit periods from the last character, restarted on each character.
+	this->base->US_RTOR = US_RTOR_TO(timeout_bits);
+	this->base->US_CR = US_CR_STTTO;
+	
+	this->base->US_IER = US_IER_ENDRX | US_IER_TIMEOUT;
+	this->base->US_PTCR = US_PTCR_RXTEN;
+}
+
+void samUSART_c::rxDMAUpdate(uint32_t status) {
+	//Buffer full: the PDC has already switched to the other one.
+	if (status & US_CSR_ENDRX) {
+		uint32_t done = this->rxDMAIndex;
+		this->stats.bytesIn += this->recieveBuffer.PushN(this->rxDMABuffer[done] + this->rxDMAFlushed, 
+			USART_RX_DMA_LENGTH - this->rxDMAFlushed);
+		this->rxDMAFlushed = 0;
+		
+		if (status & US_CSR_RXBUFF) { 
+			// Both filled before we got here: take the other one too, and restart.
+			this->stats.bytesIn += this->recieveBuffer.PushN(this->rxDMABuffer[done ^ 1], USART_RX_DMA_LENGTH);
+			this->base->US_RPR = (uint32_t)(uintptr_t)this->rxDMABuffer[done];
+			this->base->US_RCR = USART_RX_DMA_LENGTH;
+			this->base->US_RNPR = (uint32_t)(uintptr_t)this->rxDMABuffer[done ^ 1];
+		}
+		else {
+			// Completed buffer goes back in as the next one.
+			this->rxDMAIndex = done ^ 1;
+			this->base->US_RNPR = (uint32_t)(uintptr_t)this->rxDMABuffer[done];
+		}
+		this->base->US_RNCR = USART_RX_DMA_LENGTH; // Also clears ENDRX.
+	}
+	
+	//Line idle: flush whatever has arrived in the current buffer so far.
+	if (status & US_CSR_TIMEOUT) {
+		uint32_t received = USART_RX_DMA_LENGTH - this->base->US_RCR;
+		
+		// If the buffer filled meanwhile, RCR already refers to the other one; 
+		//  leave it to the ENDRX interrupt that is now pending.
+		if (!(this->base->US_CSR & US_CSR_ENDRX) && received > this->rxDMAFlushed) {
+			this->stats.bytesIn += this->recieveBuffer.PushN(this->rxDMABuffer[this->rxDMAIndex] + this->rxDMAFlushed, 
+				received - this->rxDMAFlushed);
+			this->rxDMAFlushed = received;
+		}
+		this->base->US_CR = US_CR_STTTO; // Wait for next character before timing out again.
+	}
+}
+
+
+//Multidrop: receive only frames whose address byte matches.
+void samUSART_c::MultidropFilter(int16_t address, int16_t broadcast) {
+	this->base->US_IDR = US_IDR_RXRDY | US_IDR_OVRE | US_IDR_FRAME;
+	this->multidropAddress = address;
+	this->multidropBroadcast = broadcast;
+	
+	//Accept everything, or wait for the next address byte:
+	this->multidropAccepting = (address < 0);
+	if (this->multidropAccepting) {
+		this->base->US_IER = US_IER_RXRDY | US_IER_OVRE | US_IER_FRAME;
+	}
+}
+
+void samUSART_c::WriteAddress(uint8_t address) {
+	//Address bit applies to the next character written to US_THR, which must be this one.
+	while (this->transmitBuffer.Available()) {
+		__WFI(); // Woken by transmit interrupts as the buffer empties.
+	}
+	this->base->US_CR = US_CR_SENDA;
+	this->Write(address);
+}
+
+uint32_t samUSART_c::multidropUpdate(uint32_t status) {
+	if (status & US_CSR_PARE) { // Address byte. Unread data before it was for someone else.
+		int16_t address = this->usartRead();
+		this->base->US_CR = US_CR_RSTSTA;
+		this->multidropAccepting = (this->multidropAddress < 0) || 
+			(address == this->multidropAddress) || (address == this->multidropBroadcast);
+		
+		//Only the next address byte interrupts until we are addressed again:
+		if (this->multidropAccepting) {
+			this->base->US_IER = US_IER_RXRDY | US_IER_OVRE | US_IER_FRAME;
+		}
+		else {
+			this->base->US_IDR = US_IDR_RXRDY | US_IDR_OVRE | US_IDR_FRAME;
+		}
+		return status & ~(US_CSR_PARE | US_CSR_OVRE | US_CSR_RXRDY);
+	}
+	
+	if ((status & US_CSR_RXRDY) && this->multidropAccepting) {
+		uint32_t character = this->usartRead();
+		if (!(status & US_CSR_FRAME)) { // Discard bad characters.
+			this->recieveBuffer.Push(character);
+			this->stats.bytesIn++;
+		}
+	}
+	return status;
+}
+
+
+//Frame mode: PDC receives each frame whole, receiver time-out marks its end.
+void samUSART_c::FrameModeEnable(usartFrameHandler_t handler, void* context, uint32_t timeout_bits) {
+	this->base->US_IDR = US_IDR_RXRDY;
+	this->base->US_PTCR = US_PTCR_RXTDIS;
+	this->rxDMAEnabled = false;
+	
+	this->frameContext = context;
+	this->frameHandler = handler;
+	this->base->US_RTOR = US_RTOR_TO(timeout_bits);
+	this->frameReceiveStart();
+}
+
+void samUSART_c::frameReceiveStart(void) {
+	this->frameBad = false;
+	this->base->US_RPR = (uint32_t)(uintptr_t)this->frameBuffer;
+	this->base->US_RCR = USART_FRAME_LENGTH;
+	this->base->US_CR = US_CR_RXEN | US_CR_RSTSTA | US_CR_STTTO; // Time-out counts from next character.
+	this->base->US_PTCR = US_PTCR_RXTEN;
+	this->base->US_IER = US_IER_TIMEOUT | US_IER_ENDRX;
+}
+
+void samUSART_c::frameUpdate(uint32_t status) {
+	uint32_t enabled = this->base->US_IMR;
+	
+	if (status & (US_CSR_OVRE | US_CSR_FRAME | US_CSR_PARE)) {
+		this->frameBad = true;
+	}
+	
+	//Reply sent through PDC, wait for the last byte to leave before listening again:
+	if ((enabled & US_IMR_ENDTX) && (status & US_CSR_ENDTX)) {
+		this->base->US_IDR = US_IDR_ENDTX;
+		this->base->US_IER = US_IER_TXEMPTY;
+		return;
+	}
+	if ((enabled & US_IMR_TXEMPTY) && (status & US_CSR_TXEMPTY)) {
+		this->base->US_IDR = US_IDR_TXEMPTY;
+		this->base->US_PTCR = US_PTCR_TXTDIS;
+		this->usartRead(); // Discard anything heard while transmitting.
+		this->frameReceiveStart();
+		return;
+	}
+	
+	//Overlong frame: keep draining into the buffer until the line goes quiet, then drop it.
+	if ((enabled & US_IMR_ENDRX) && (status & US_CSR_ENDRX)) {
+		this->frameBad = true;
+		this->base->US_RPR = (uint32_t)(uintptr_t)this->frameBuffer;
+		this->base->US_RCR = USART_FRAME_LENGTH;
+	}
+	
+	if (!((enabled & US_IMR_TIMEOUT) && (status & US_CSR_TIMEOUT))) {
+		return; // Frame not finished yet.
+	}
+	
+	uint32_t length = USART_FRAME_LENGTH - this->base->US_RCR;
+	if (this->frameBad || length == 0) {
+		this->frameReceiveStart();
+		return;
+	}
+	this->stats.bytesIn += length;
+	
+	//Stop receiving while the handler runs and any reply goes out:
+	this->base->US_IDR = US_IDR_TIMEOUT | US_IDR_ENDRX;
+	this->base->US_PTCR = US_PTCR_RXTDIS;
+	this->base->US_CR = US_CR_RXDIS;
+	
+	uint32_t reply = this->frameHandler(this->frameContext, this->frameBuffer, length, USART_FRAME_LENGTH);
+	if (reply == 0) {
+		this->frameReceiveStart();
+		return;
+	}
+	
+	this->stats.bytesOut += reply;
+	this->base->US_TPR = (uint32_t)(uintptr_t)this->frameBuffer;
+	this->base->US_TCR = reply;
+	this->base->US_PTCR = US_PTCR_TXTEN;
+	this->base->US_IER = US_IER_ENDTX;
+}
+
+
+//Manchester frames: PDC receives into the frame queue, receiver time-out ends each frame.
+void samUSART_c::ManchesterFramesEnable(uint32_t timeout_bits) {
+	this->base->US_IDR = US_IDR_RXRDY;
+	this->base->US_PTCR = US_PTCR_RXTDIS;
+	this->rxDMAEnabled = false;
+	
+	this->manchFrames = true;
+	this->base->US_RTOR = US_RTOR_TO(timeout_bits);
+	this->base->US_IER = US_IER_MANE;
+	this->manchReceiveStart();
+}
+
+usartFrame_t* samUSART_c::ManchesterFrameGet(void) {
+	uint32_t count;
+	usartFrame_t* frame = this->manchQueue.ReadRegion(&count);
+	return count ? frame : NULL;
+}
+
+void samUSART_c::ManchesterFrameRelease(void) {
+	this->manchQueue.CommitRead(1);
+}
+
+void samUSART_c::manchReceiveStart(void) {
+	uint32_t free;
+	usartFrame_t* slot = this->manchQueue.WriteRegion(&free);
+	
+	this->manchTarget = free ? slot : NULL;
+	this->manchOverlong = false;
+	this->manchErrors = 0;
+	
+	//Queue full: still receive the frame, to find its end, but throw it away.
+	this->base->US_RPR = (uint32_t)(uintptr_t)(free ? slot->data : this->frameBuffer);
+	this->base->US_RCR = USART_MANCH_FRAME_LENGTH;
+	this->base->US_CR = US_CR_STTTO; // Time-out counts from next character.
+	this->base->US_PTCR = US_PTCR_RXTEN;
+	this->base->US_IER = US_IER_TIMEOUT | US_IER_ENDRX;
+}
+
+void samUSART_c::manchUpdate(uint32_t status) {
+	uint32_t enabled = this->base->US_IMR;
+	
+	this->manchErrors |= status & (US_CSR_MANERR | US_CSR_OVRE | US_CSR_FRAME | US_CSR_PARE);
+	
+	//Overlong frame: drain the rest into frameBuffer until the line goes quiet.
+	if ((enabled & US_IMR_ENDRX) && (status & US_CSR_ENDRX)) {
+		this->manchOverlong = true;
+		this->base->US_RPR = (uint32_t)(uintptr_t)this->frameBuffer;
+		this->base->US_RCR = USART_FRAME_LENGTH;
+	}
+	
+	if (!((enabled & US_IMR_TIMEOUT) && (status & US_CSR_TIMEOUT))) {
+		return; // Frame not finished yet.
+	}
+	
+	uint32_t length = USART_MANCH_FRAME_LENGTH - this->base->US_RCR;
+	if (this->manchTarget && !this->manchOverlong) {
+		this->manchTarget->errors = this->manchErrors;
+		this->manchTarget->length = length;
+		this->manchQueue.CommitWrite(1);
+		this->stats.bytesIn += length;
+	}
+	else {
+		this->manchDrops++;
+	}
+	this->manchReceiveStart();
+}
+
+
+//Handshaking receive: publish whatever the PDC has written into recieveBuffer so far.
+void samUSART_c::rxFlowCommit(void) {
+	// Next counter read first, so a reload in between can only under-count.
+	uint32_t pending = this->base->US_RNCR;
+	pending += this->base->US_RCR;
+	int32_t received = this->rxFlowLoaded - pending;
+	
+	if (received > 0) {
+		this->recieveBuffer.CommitWrite(received);
+		this->rxFlowLoaded -= received;
+		this->stats.bytesIn += received;
+	}
+}
+
+//Handshaking receive: hand the PDC more free space when a counter is free. 
+// When the buffer is full the PDC runs dry, which turns RTS off in hardware.
+void samUSART_c::rxFlowRefill(void) {
+	if (this->base->US_RCR && this->base->US_RNCR) {
+		return; // Both loaded already.
+	}
+	
+	uint32_t length;
+	uint32_t space = this->recieveBuffer.Space();
+	uint32_t usable = (space > USART_RX_FLOW_HEADROOM + this->rxFlowLoaded) ? 
+		space - USART_RX_FLOW_HEADROOM - this->rxFlowLoaded : 0;
+	uint8_t* region = this->recieveBuffer.WriteRegion(&length, this->rxFlowLoaded);
+	
+	if (length > usable) {
+		length = usable;
+	}
+	
+	if (length == 0) {
+		this->rxFlowHeld = true;
+		if (this->base->US_RCR == 0) {
+			// PDC stopped and RTS off: catch any bytes the other end already had 
+			//  in flight one at a time, into the headroom.
+			this->base->US_IDR = US_IDR_ENDRX | US_IDR_RXBUFF;
+			this->base->US_IER = US_IER_RXRDY;
+		}
+		else {
+			// Still receiving into the last region - get told when it stops.
+			this->base->US_IDR = US_IDR_ENDRX;
+			this->base->US_IER = US_IER_RXBUFF;
+		}
+		return;
+	}
+	
+	if (this->base->US_RCR == 0) { // Stopped: restart, which turns RTS back on.
+		this->base->US_RPR = (uint32_t)(uintptr_t)region;
+		this->base->US_RCR = length;
+	}
+	else {
+		this->base->US_RNPR = (uint32_t)(uintptr_t)region;
+		this->base->US_RNCR = length;
+		if (this->base->US_RCR == 0 && this->base->US_RNCR) { 
+			// Current ran out just before next was loaded - move it over ourselves.
+			this->base->US_RPR = (uint32_t)(uintptr_t)region;
+			this->base->US_RCR = length;
+			this->base->US_RNCR = 0;
+		}
+	}
+	this->rxFlowLoaded += length;
+	
+	this->rxFlowHeld = false;
+	this->base->US_IDR = US_IDR_RXRDY | US_IDR_RXBUFF;
+	this->base->US_IER = US_IER_ENDRX;
+}
+
+
+//Queue an SPI transfer, starting it now if the bus is idle.
+bool samUSART_c::TransferQueue(usartSPITransfer_t* transfer) {
+	transfer->done = false;
+	if (!this->spiQueue.Push(transfer)) {
+		return false;
+	}
+	
+	//Interrupt handler starts the rest, once this one is going.
+	IRQn_Type irq = this->ch_id ? USART1_IRQn : USART0_IRQn;
+	NVIC_DisableIRQ(irq);
+	if (this->spiCurrent == NULL) {
+		this->spiStartNext();
+	}
+	NVIC_EnableIRQ(irq);
+	return true;
+}
+
+//Single SPI transfer using the USART's own chip select, waiting until done.
+bool samUSART_c::Transfer(const uint8_t* tx, uint8_t* rx, uint16_t length) {
+	usartSPITransfer_t transfer = {tx, rx, length, NULL, 0, NULL, false};
+	
+	if (!this->TransferQueue(&transfer)) {
+		return false;
+	}
+	while (!transfer.done) {
+		__WFI(); // Woken by the end-of-transfer interrupt.
+	}
+	return true;
+}
+
+void samUSART_c::spiStartNext(void) {
+	//Sets up PDC for next queued transfer, or goes idle.
+	usartSPITransfer_t* transfer = this->spiQueue.Pop();
+	
+	this->spiCurrent = transfer;
+	if (transfer == NULL) {
+		return;
+	}
+	
+	if (transfer->csPort) {
+		transfer->csPort->PinSetLow(transfer->csPin);
+	}
+	else {
+		this->base->US_CR = US_CR_FCS; // Force NSS low.
+	}
+	
+	//Discard anything left over in the receiver:
+	this->usartRead();
+	this->base->US_CR = US_CR_RSTSTA;
+	
+	//Receive-only transfers clock out 0xFF, sent from the receive buffer ahead of reception.
+	const uint8_t* txData = transfer->tx;
+	if (txData == NULL) {
+		memset(transfer->rx, 0xFF, transfer->length);
+		txData = transfer->rx;
+	}
+	
+	if (transfer->rx) {
+		this->base->US_RPR = (uint32_t)(uintptr_t)transfer->rx;
+		this->base->US_RCR = transfer->length;
+		this->base->US_IER = US_IER_ENDRX; // Last byte received => transfer finished.
+	}
+	else {
+		this->base->US_IER = US_IER_ENDTX; // Then wait for TXEMPTY.
+	}
+	this->base->US_TPR = (uint32_t)(uintptr_t)txData;
+	this->base->US_TCR = transfer->length;
+	
+	this->base->US_PTCR = (transfer->rx ? US_PTCR_RXTEN : 0) | US_PTCR_TXTEN;
+}
+
+void samUSART_c::spiUpdate(uint32_t status) {
+	//Finishes current transfer from its end interrupt, then starts the next.
+	uint32_t enabled = this->base->US_IMR;
+	usartSPITransfer_t* transfer = this->spiCurrent;
+	
+	if ((enabled & US_IMR_ENDTX) && (status & US_CSR_ENDTX)) {
+		// Transmit-only: PDC done, but last byte is still shifting out.
+		this->base->US_IDR = US_IDR_ENDTX;
+		this->base->US_IER = US_IER_TXEMPTY;
+		return;
+	}
+	
+	if (!((enabled & US_IMR_ENDRX) && (status & US_CSR_ENDRX)) && 
+		!((enabled & US_IMR_TXEMPTY) && (status & US_CSR_TXEMPTY))) {
+		return; // Not finished yet.
+	}
+	
+	this->base->US_IDR = US_IDR_ENDRX | US_IDR_TXEMPTY;
+	this->base->US_PTCR = US_PTCR_RXTDIS | US_PTCR_TXTDIS;
+	
+	if (transfer->csPort) {
+		transfer->csPort->PinSetHigh(transfer->csPin);
+	}
+	else {
+		this->base->US_CR = US_CR_RCS; // Release NSS.
+	}
+	
+	this->stats.bytesOut += transfer->length;
+	this->stats.bytesIn += transfer->rx ? transfer->length : 0;
+	
+	transfer->done = true;
+	if (transfer->callback) {
+		transfer->callback(transfer);
+	}
+	this->spiStartNext();
 }
 
 
 //Updater: manages peripheral and buffers. Later: call as interrupt handler.
 void samUSART_c::Update(void) {
 	//Moves data from buffer to hardware registers, as appropriate.
-	if (this->usartReadReady()) {
-		this->recieveBuffer.Push(this->usartRead());
+	uint32_t status = this->base->US_CSR;
+	
+	if (this->mode == usart_modeSPIMaster) {
+		this->spiUpdate(status);
+		this->stats.interrupts++;
+		return;
 	}
 	
-	if (this->usartWriteReady() && this->transmitBuffer.Available()) {
+	if (this->frameHandler) {
+		this->frameUpdate(status);
+	}
+	else if (this->manchFrames) {
+		this->manchUpdate(status);
+	}
+	else if (this->rxFlowControl) {
+		// RHR is only ours once the PDC has stopped - until then it takes every 
+		//  byte itself, into the slot a Push would use. Counter read before the 
+		//  commit, so the commit then publishes all of the PDC's bytes.
+		bool stopped = (this->base->US_RCR == 0);
+		this->rxFlowCommit(); // Before any Push, so the PDC's bytes stay in order.
+		if (this->rxFlowHeld && stopped && this->usartReadReady()) { // Bytes after RTS went off.
+			this->recieveBuffer.Push(this->usartRead());
+			this->stats.bytesIn++;
+		}
+		this->rxFlowRefill();
+		if (status & US_CSR_TIMEOUT) {
+			this->base->US_CR = US_CR_STTTO;
+		}
+	}
+	else if (this->multidrop) {
+		status = this->multidropUpdate(status);
+	}
+	else if (this->rxDMAEnabled) {
+		this->rxDMAUpdate(status);
+	}
+	else if (status & US_CSR_RXRDY) {
+		uint32_t character = this->usartRead();
+		if (!(status & (US_CSR_FRAME | US_CSR_PARE))) { // Discard bad characters.
+			this->recieveBuffer.Push(character);
+			this->stats.bytesIn++;
+		}
+	}
+	
+	//Error counters. Errors also interrupt, so none are missed in PDC mode.
+	if (status & (US_CSR_OVRE | US_CSR_FRAME | US_CSR_PARE | US_CSR_MANERR)) {
+		this->stats.overrunErrors += (status & US_CSR_OVRE) != 0;
+		this->stats.framingErrors += (status & US_CSR_FRAME) != 0;
+		this->stats.parityErrors += (status & US_CSR_PARE) != 0;
+		this->stats.manchesterErrors += (status & US_CSR_MANERR) != 0;
+		this->base->US_CR = US_CR_RSTSTA;
+	}
+	
+	if ((status & US_CSR_TXRDY) && this->transmitBuffer.Available()) {
 		this->usartWrite(this->transmitBuffer.Pop());
+		this->stats.bytesOut++;
 	}
-	else { // Don't want spontaneous interrupts.
+	else if (!this->transmitBuffer.Available()) { // Don't want spontaneous interrupts.
 		this->base->US_IDR = US_IDR_TXRDY;
+		if (this->transmitBuffer.Available()) { // Write() got in just before disabling.
+			this->base->US_IER = US_IER_TXRDY;
+		}
 	}
+	
+	this->stats.interrupts++;
+}
+
+//Snapshot of counters, plus buffer drop and peak figures.
+serialStats_t samUSART_c::StatsGet(void) {
+	serialStats_t snapshot = this->stats;
+	
+	snapshot.rxDrops = this->recieveBuffer.DroppedCount() + this->manchDrops;
+	snapshot.txDrops = this->transmitBuffer.DroppedCount();
+	snapshot.rxPeak = this->recieveBuffer.HighWaterMark();
+	snapshot.txPeak = this->transmitBuffer.HighWaterMark();
+	snapshot.linesDiscarded = this->lineState.discarded;
+	snapshot.linesOverrun = this->lineState.overrun;
+	return snapshot;
 }
 
 //Write a single byte to internal buffer.
@@ -132,17 +760,70 @@ void samUSART_c::Write(uint8_t byte) {
 	//Enable interrupts, to call updater:
 	this->base->US_IER = US_IER_TXRDY;
 }
+//Write a block of bytes to internal buffer.
+uint32_t samUSART_c::WriteBlock(const uint8_t* data, uint32_t num_bytes) {
+	uint32_t accepted = this->transmitBuffer.PushN(data, num_bytes);
+	this->base->US_IER = US_IER_TXRDY;
+	return accepted;
+}
+//Free space in internal transmit buffer.
+uint32_t samUSART_c::WriteSpace(void) {
+	return this->transmitBuffer.Space();
+}
+//Write a block, sleeping until there is room for all of it or timeout.
+uint32_t samUSART_c::WriteWait(const uint8_t* data, uint32_t num_bytes, uint32_t timeout_us) {
+	sysTickTimeout_c timeout(timeout_us);
+	uint32_t sent = this->WriteBlock(data, num_bytes);
+	
+	// Buffer is full, so a transmit interrupt is always still to come to wake us.
+	while (sent < num_bytes && !timeout.Expired()) {
+		__WFI();
+		sent += this->WriteBlock(data + sent, num_bytes - sent);
+	}
+	return sent;
+}
+//Read up to num_bytes from internal buffer, returns number read.
+uint32_t samUSART_c::ReadBlock(uint8_t* data, uint32_t num_bytes) {
+	uint32_t count = this->recieveBuffer.PopN(data, num_bytes);
+	this->rxFlowResume();
+	return count;
+}
 //Check if data has been received:
 uint32_t samUSART_c::Available(void) {
 	return this->recieveBuffer.Available();
 }
 //Read a single byte from internal buffer.
 int16_t samUSART_c::Read(void) {
-	if (this->recieveBuffer.Available())
-		return this->recieveBuffer.Pop();
+	if (this->recieveBuffer.Available()) {
+		uint8_t byte = this->recieveBuffer.Pop();
+		this->rxFlowResume();
+		return byte;
+	}
 	else
 		return -1;
 }
+//Line framing: the search and release are shared with the UART driver.
+void samUSART_c::LineConfig(uint8_t delimiter, uint32_t maxLength) {
+	this->lineState.delimiter = delimiter;
+	this->lineState.maxLength = (maxLength < USART_BUFF_LENGTH) ? maxLength : USART_BUFF_LENGTH - 1;
+	this->lineState.scanned = 0;
+}
+bool samUSART_c::LineGet(serialLine_t* line) {
+	bool complete = serialLineGet(&this->recieveBuffer, &this->lineState, line);
+	this->rxFlowResume(); // Overlong lines may have been dropped.
+	return complete;
+}
+bool samUSART_c::LineRelease(void) {
+	bool intact = serialLineRelease(&this->recieveBuffer, &this->lineState);
+	this->rxFlowResume();
+	return intact;
+}
+//Handshaking: after reading, let the interrupt handler give the PDC the freed space.
+void samUSART_c::rxFlowResume(void) {
+	if (this->rxFlowHeld) {
+		NVIC_SetPendingIRQ(this->ch_id ? USART1_IRQn : USART0_IRQn);
+	}
+}
 //Read a single byte from internal buffer, without consuming.
 int16_t samUSART_c::Peek(void) {
 	if (this->recieveBuffer.Available())
@@ -153,8 +834,10 @@ int16_t samUSART_c::Peek(void) {
 
 
 //Constructor - allows instances for each peripheral. Not for general use.
-samUSART_c::samUSART_c(int id) : ch_id(id) 
+samUSART_c::samUSART_c(int id) : ch_id(id), mode(usart_modeSerialAsync), lineState(), stats(), baudActual(0), baudError(0), rxDMAEnabled(false), multidrop(false), rxFlowControl(false), 
+	rxFlowHeld(false), frameHandler(NULL), manchFrames(false), manchDrops(0), spiCurrent(NULL)
 {
+	this->LineConfig('\n', USART_BUFF_LENGTH - 1);
 	if (id) {
 		this->base = USART1;
 	}
@@ -163,6 +846,13 @@ samUSART_c::samUSART_c(int id) : ch_id(id)
 	}
 }
 
+#ifdef SAM4LIB_HOST_TEST
+samUSART_c::samUSART_c(int id, Usart* registers) : samUSART_c(id)
+{
+	this->base = registers;
+}
+#endif
+
 
 //Single read or write from registers:
 void samUSART_c::usartWrite(uint32_t data) {
@@ -5,10 +5,6 @@
  * This implementation is far from complete; the USART contains a LOT of options. 
  * Only the most commonly used protocols are implemented in code.
  *
- * TODO list:
- *     - Add SPI mode support
- *     - Add hardware handshaking (CTS/RTS) to serial modes.
- * 
  * Created: 2/07/2016 5:55:22 PM
  *  Author: Ben Jones
  */
@@ -18,16 +14,27 @@
 #define SAMUSART_HPP_
 
 #include "sam.h"
+#include "samGPIO.hpp"
+#include "samSystick.hpp"
 #include "../Utilities/CircBuf.hpp"
 #include "../Utilities/serial-funcs.hpp"
 
 
 #define USART_BUFF_LENGTH 256
+#define USART_RX_DMA_LENGTH 64 // Size of each of the two PDC receive buffers.
+#define USART_SPI_QUEUE_LENGTH 8 // Pending SPI transfers, must be a power of two.
+#define USART_RX_FLOW_TIMEOUT 20 // Handshaking: idle bit periods before received data is made available.
+#define USART_RX_FLOW_HEADROOM 16 // Handshaking: buffer space kept for bytes sent after RTS goes off.
+#define USART_BAUD_TOLERANCE_PPM 20000 // Asynchronous rates further off than this are refused by Begin.
+#define USART_FRAME_LENGTH 256 // Frame mode receive/reply buffer, e.g. one Modbus RTU frame.
+#define USART_MANCH_FRAME_LENGTH 64 // Largest Manchester frame kept by the frame queue.
+#define USART_MANCH_QUEUE_LENGTH 4 // Manchester frames queued, must be a power of two.
 
 // Defined options for function arguments:
-enum {usart_modeSerialSynch, usart_modeSerialAsync, usart_modeManchester};
+enum {usart_modeSerialSynch, usart_modeSerialAsync, usart_modeManchester, usart_modeSPIMaster};
 
-enum {usart_parityNone = 0x04, usart_parityEven = 0x00, usart_parityOdd = 0x01, usart_parityMark = 0x03, usart_paritySpace = 0x02};
+enum {usart_parityNone = 0x04, usart_parityEven = 0x00, usart_parityOdd = 0x01, usart_parityMark = 0x03, usart_paritySpace = 0x02, 
+	usart_parityMultidrop = 0x06};
 
 
 // Consult the datasheet for information on what the following options are doing. 
@@ -39,20 +46,56 @@ enum {usart_optionSynchClockLocal = 0x00, usart_optionSynchClockRemote = 0x01,
 	usart_optionSynchMSBFirst = 0x10,
 	usart_optionSynchInvertData = 0x20};
 
-//For asynchronous serial (UART) mode:
+//For asynchronous serial (UART) mode. Handshaking uses the RTS and CTS pins: 
+// CTS gates our transmitter, and RTS is turned off when the receive buffer fills.
+// RS-485 drives RTS high while transmitting, for the line driver's enable pin.
 enum {usart_optionAsyncMSBFirst = 0x10,
-	usart_optionAsyncInvertData = 0x20};
+	usart_optionAsyncInvertData = 0x20, 
+	usart_optionAsyncHandshaking = 0x40, 
+	usart_optionAsyncRS485 = 0x80};
 
-//For Manchester mode:
+//For Manchester mode. The preamble (length 0 to 15 bits) and a one-bit start 
+// frame delimiter go before every character, and are checked by the receiver:
 enum {usart_optionManchInvertPolarity = 0x01, usart_optionManchInvertStartbit = 0x02, 
 	usart_optionManchPreambleAllOne = 0x00, usart_optionManchPreambleAllZero = 0x10, usart_optionManchPreambleZeroOne = 0x20, usart_optionManchPreambleOneZero = 0x30};
-#define usart_optionManchPreambleLength(length) (length & 0xf) << 2
+#define usart_optionManchPreambleLength(length) (((length) & 0xf) << 8)
+
+//For SPI master mode (baud_clockrate is SCK frequency, parity is ignored). 
+// Standard SPI modes 0 to 3 - clock polarity and phase:
+enum {usart_optionSPIMode0 = 0x00, usart_optionSPIMode1 = 0x01, 
+	usart_optionSPIMode2 = 0x02, usart_optionSPIMode3 = 0x03};
+
+
+//One SPI transfer, for TransferQueue(). Must stay valid until done is set. 
+struct usartSPITransfer_t {
+	const uint8_t* tx;		// Data to send, or NULL to send 0xFF bytes.
+	uint8_t* rx;			// Received data, or NULL to discard (not both NULL). Can be the same as tx.
+	uint16_t length;		// Bytes each way (PDC counters are 16-bit).
+	gpioPort_c* csPort;		// Chip select, driven low for the transfer. 
+	uint32_t csPin;			//   NULL port uses the USART's own RTS/NSS pin.
+	void (*callback)(usartSPITransfer_t* transfer); // Called from interrupt when done, or NULL.
+	volatile bool done;		// Set once transfer is finished and chip select released.
+};
+
+
+//One received Manchester frame, in the frame queue. See ManchesterFramesEnable().
+struct usartFrame_t {
+	uint32_t errors;	// US_CSR error flags seen during the frame (MANERR, OVRE...), 0 if clean.
+	uint32_t length;
+	uint8_t data[USART_MANCH_FRAME_LENGTH];
+};
+
+//Frame handler, for FrameModeEnable(). Called from interrupt with one complete frame. 
+// It may build a reply in place, up to maxLength bytes, and return its length (or 0).
+typedef uint32_t (*usartFrameHandler_t)(void* context, uint8_t* frame, uint32_t length, uint32_t maxLength);
 
 
 class samUSART_c: public SerialStream {
 	public:
-		//Initialiser: sets up peripheral. Use bitwise OR for multiple options.
-		void Begin(uint32_t mode, uint32_t baud_clockrate, uint32_t parity, uint32_t options);
+		//Initialiser: sets up peripheral. Use bitwise OR for multiple options. 
+		// Returns false, leaving the USART off, if an asynchronous baud rate can't 
+		// be made within USART_BAUD_TOLERANCE_PPM from the current master clock.
+		bool Begin(uint32_t mode, uint32_t baud_clockrate, uint32_t parity, uint32_t options);
 		
 		//Access internal buffer to send/recieve bytes. 
 		// I recommend using the functions in the SerialStream class instead!
@@ -61,10 +104,85 @@ class samUSART_c: public SerialStream {
 		int16_t Peek(void); // Same as read but doesn't consume data.
 		void Write(uint8_t byte);
 		
+		//Block versions - one buffer operation and one interrupt enable per block.
+		// WriteBlock returns how many bytes fitted; the rest are not sent.
+		uint32_t WriteBlock(const uint8_t* data, uint32_t num_bytes);
+		uint32_t ReadBlock(uint8_t* data, uint32_t num_bytes);
+		
+		//Backpressure: free space in transmit buffer, and a write that sleeps 
+		// until everything is accepted or timeout_us passes (needs samSysTick 
+		// running). Returns bytes accepted.
+		uint32_t WriteSpace(void);
+		uint32_t WriteWait(const uint8_t* data, uint32_t num_bytes, uint32_t timeout_us);
+		
+		//Line framing in place: LineGet returns true with the next complete line 
+		// as pointers into the receive buffer (nothing is copied), to be handed 
+		// back with LineRelease. Lines longer than maxLength (at most the buffer 
+		// length - 1) are dropped whole and counted in StatsGet(). Defaults to 
+		// '\n' and the longest line that fits. Avoid Read() etc. while lines are in use.
+		//The receive buffer overwrites its oldest bytes when full, so a line held 
+		// while it fills is lost: LineRelease then returns false (and counts it in 
+		// StatsGet()), and what was read from the line can't be trusted.
+		void LineConfig(uint8_t delimiter, uint32_t maxLength);
+		bool LineGet(serialLine_t* line);
+		bool LineRelease(void);
+		
+		//Receive through the PDC instead of one interrupt per byte. Call after Begin.
+		// Partial buffers are flushed to Read() after the line has been idle 
+		// for timeout_bits bit periods (1 to 65535). With handshaking, the PDC is 
+		// already in use and this only changes the timeout.
+		void RxDMAEnable(uint32_t timeout_bits);
+		
+		//Multidrop (9-bit) mode, from Begin with usart_parityMultidrop: the ninth bit 
+		// marks address bytes, which start each frame. Only frames starting with 
+		// address or broadcast are received; any other frame costs one interrupt, 
+		// for its address byte. Address bytes are not passed to Read(). Use -1 to 
+		// accept all frames (the default). Byte-wise receive only, not with RxDMAEnable.
+		void MultidropFilter(int16_t address, int16_t broadcast);
+		//Sends an address byte to start a frame, once queued data has gone (waits with WFI).
+		void WriteAddress(uint8_t address);
+		
+		//Frame mode: whole frames are received by the PDC, delimited by timeout_bits 
+		// of idle line, and passed to handler from the interrupt. A reply is sent 
+		// straight from the frame buffer by the PDC, with the receiver off until it 
+		// has left the shifter (so RS-485 echo is ignored). Frames with errors, or 
+		// longer than USART_FRAME_LENGTH, are dropped. Call after Begin; Read() and 
+		// Write() are not used while frame mode is on.
+		void FrameModeEnable(usartFrameHandler_t handler, void* context, uint32_t timeout_bits);
+		
+		//Manchester frames: the PDC receives each frame straight into a slot of a 
+		// preallocated queue, ended by timeout_bits of idle line. Frames are kept 
+		// with any errors flagged; overlong frames, and frames arriving with the 
+		// queue full, are dropped and counted in rxDrops. Call after Begin in 
+		// Manchester mode. FrameGet returns the oldest frame (NULL if none), which 
+		// stays valid until FrameRelease.
+		void ManchesterFramesEnable(uint32_t timeout_bits);
+		usartFrame_t* ManchesterFrameGet(void);
+		void ManchesterFrameRelease(void);
+		
+		//SPI master mode: full-duplex transfers through the PDC, one interrupt per 
+		// transfer. Queued transfers run in order, each with its own chip select, 
+		// so several devices can share the bus. TransferQueue returns false if 
+		// the queue is full; Transfer waits (with WFI) for its transfer to finish.
+		bool TransferQueue(usartSPITransfer_t* transfer);
+		bool Transfer(const uint8_t* tx, uint8_t* rx, uint16_t length);
+		
+		//Link statistics: byte and error counts, buffer drops and peaks.
+		serialStats_t StatsGet(void);
+		
+		//Achieved baud (or SPI/synchronous clock) rate from the last Begin, and its 
+		// error from the requested rate in parts per million. 0 with a remote clock.
+		uint32_t BaudGet(void);
+		int32_t BaudErrorPPM(void);
+		
 		//Updater - called as interrupt handler, but can be polled also.
 		void Update(void);
 		//Constructor - allows instances for each peripheral. Not for general use.
 		samUSART_c(int id);
+#ifdef SAM4LIB_HOST_TEST
+		//Host tests drive the USART through a simulated register block instead.
+		samUSART_c(int id, Usart* registers);
+#endif
 	
 	private:
 		//Single read or write from registers:
@@ -75,11 +193,78 @@ class samUSART_c: public SerialStream {
 		bool usartReadReady(void);
 		bool usartWriteReady(void);
 		
+		//Baud rate generator settings for a requested rate. Set baudActual.
+		uint32_t baudAsyncSelect(uint32_t baud, bool allow8x, uint32_t* sampling);
+		uint32_t baudSyncSelect(uint32_t rate, uint32_t minimum);
+		
+		//Multidrop receive, given US_CSR. Returns status without the flags it has dealt with.
+		uint32_t multidropUpdate(uint32_t status);
+		
+		//Moves PDC receive buffers into recieveBuffer, given US_CSR.
+		void rxDMAUpdate(uint32_t status);
+		
+		//Handshaking receive: PDC writes straight into recieveBuffer's free space.
+		void rxFlowCommit(void);
+		void rxFlowRefill(void);
+		void rxFlowResume(void);
+		
+		//Frame mode receive and reply sequencing, from interrupt.
+		void frameUpdate(uint32_t status);
+		void frameReceiveStart(void);
+		
+		//Manchester frame queue sequencing, from interrupt.
+		void manchUpdate(uint32_t status);
+		void manchReceiveStart(void);
+		
+		//SPI transfer sequencing, from interrupt (or with interrupts masked).
+		void spiUpdate(uint32_t status);
+		void spiStartNext(void);
+		
 		//State variables:
 		int ch_id;
+		uint32_t mode;
 		Usart* base;
-		CircBuf_c<uint8_t, USART_BUFF_LENGTH> recieveBuffer;
-		CircBuf_c<uint8_t, USART_BUFF_LENGTH> transmitBuffer;
+		CircBuf_c<uint8_t, USART_BUFF_LENGTH, circbuf_overwriteOldest, true> recieveBuffer;
+		CircBuf_c<uint8_t, USART_BUFF_LENGTH, circbuf_dropNewest, true> transmitBuffer;
+		serialLineState_t lineState; // LineGet() progress through recieveBuffer.
+		serialStats_t stats; // Counters kept by Update(); buffer figures filled in by StatsGet().
+		uint32_t baudActual;
+		int32_t baudError; // Parts per million.
+		
+		//PDC receive ping-pong buffers:
+		bool rxDMAEnabled;
+		uint32_t rxDMAIndex; // Buffer the PDC is currently filling.
+		uint32_t rxDMAFlushed; // Bytes of that buffer already pushed on timeout.
+		uint8_t rxDMABuffer[2][USART_RX_DMA_LENGTH];
+		
+		//Multidrop address filter:
+		bool multidrop;
+		bool multidropAccepting; // Last address byte matched, so data bytes are wanted.
+		int16_t multidropAddress; // -1 for any.
+		int16_t multidropBroadcast;
+		
+		//Handshaking receive state:
+		bool rxFlowControl;
+		volatile bool rxFlowHeld; // Out of buffer space, RTS off. Reads re-trigger the interrupt.
+		uint32_t rxFlowLoaded; // Bytes of free space handed to the PDC, not yet committed.
+		
+		//Frame mode state:
+		usartFrameHandler_t frameHandler; // NULL when frame mode is off.
+		void* frameContext;
+		bool frameBad; // Error or overflow seen in the frame being received.
+		uint8_t frameBuffer[USART_FRAME_LENGTH];
+		
+		//Manchester frame queue state. Frames that can't be kept go to frameBuffer.
+		bool manchFrames;
+		bool manchOverlong; // Frame being received is too long, and is being drained.
+		uint32_t manchErrors; // Error flags for the frame being received.
+		uint32_t manchDrops;
+		usartFrame_t* manchTarget; // Queue slot being received into, or NULL.
+		CircBuf_c<usartFrame_t, USART_MANCH_QUEUE_LENGTH, circbuf_reject> manchQueue;
+		
+		//SPI transfer queue:
+		CircBuf_c<usartSPITransfer_t*, USART_SPI_QUEUE_LENGTH, circbuf_reject> spiQueue;
+		usartSPITransfer_t* spiCurrent; // In progress, or NULL when idle.
 	
 };
 
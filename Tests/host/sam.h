@@ -0,0 +1,294 @@
+/*
+ * sam.h (host build)
+ * Simulated SAM4S register block for the host tests in Tests/: stands in for 
+ * the Atmel device header, with each peripheral a plain struct in memory 
+ * instead of at its hardware address. Only what the drivers use is here.
+ *
+ * Tests play the hardware's part themselves - setting status bits, moving 
+ * PDC counters - and call the driver's Update() as its interrupt would. 
+ * Tests define SAM4LIB_HOST_TEST (for the drivers' register-injecting
+ * constructors) and build with -ITests/host.
+ *
+ * Created: 17/10/2026
+ */
+
+#ifndef SAM_HOST_H_
+#define SAM_HOST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __I volatile
+#define __O volatile
+#define __IO volatile
+typedef volatile uint32_t RoReg; // Writable here, so tests can set status bits.
+typedef volatile uint32_t WoReg;
+typedef volatile uint32_t RwReg;
+
+//Interrupt enable/disable registers set and clear bits in the mask register 
+// MaskOffset words further on, as the hardware does, so tests see the net 
+// effect of several IER/IDR writes in one call.
+template <int MaskOffset, bool Enable>
+struct simMaskReg_t {
+	volatile uint32_t written;
+	void operator=(uint32_t value) {
+		this->written = value;
+		volatile uint32_t* mask = &this->written + MaskOffset;
+		*mask = Enable ? (*mask | value) : (*mask & ~value);
+	}
+};
+
+//Receive holding registers: reading one clears RXRDY (bit 0) in the status 
+// register the word before, as the hardware does. Tests store into .value.
+struct simReceiveReg_t {
+	volatile uint32_t value;
+	operator uint32_t() {
+		*(&this->value - 1) &= ~0x1u;
+		return this->value;
+	}
+};
+
+//PDC pointer registers are 32 bits but host addresses are not. Drivers 
+// store the low half; simPointer() restores it, for buffers that live near 
+// the register blocks (static storage).
+static inline uint8_t* simPointer(uint32_t reg);
+
+typedef struct {
+	WoReg UART_CR; RwReg UART_MR; simMaskReg_t<2, true> UART_IER; simMaskReg_t<1, false> UART_IDR; 
+	RoReg UART_IMR; RoReg UART_SR; simReceiveReg_t UART_RHR; WoReg UART_THR; RwReg UART_BRGR;
+	RoReg Reserved1[55];
+	RwReg UART_RPR; RwReg UART_RCR; RwReg UART_TPR; RwReg UART_TCR; RwReg UART_RNPR; RwReg UART_RNCR; 
+	RwReg UART_TNPR; RwReg UART_TNCR; WoReg UART_PTCR; RoReg UART_PTSR;
+} Uart;
+
+typedef struct {
+	WoReg US_CR; RwReg US_MR; simMaskReg_t<2, true> US_IER; simMaskReg_t<1, false> US_IDR; 
+	RoReg US_IMR; RoReg US_CSR; simReceiveReg_t US_RHR; WoReg US_THR; RwReg US_BRGR; RwReg US_RTOR; RwReg US_TTGR;
+	RoReg Reserved1[5]; RwReg US_FIDI; RoReg US_NER; RoReg Reserved2[1]; RwReg US_IF; RwReg US_MAN;
+	RoReg Reserved3[36]; RwReg US_WPMR; RoReg US_WPSR; RoReg Reserved4[5];
+	RwReg US_RPR; RwReg US_RCR; RwReg US_TPR; RwReg US_TCR; RwReg US_RNPR; RwReg US_RNCR; 
+	RwReg US_TNPR; RwReg US_TNCR; WoReg US_PTCR; RoReg US_PTSR;
+} Usart;
+
+typedef struct {
+	RwReg PIO_PER, PIO_PDR, PIO_PSR, PIO_SODR, PIO_CODR, PIO_ODSR, PIO_PDSR, PIO_OER, PIO_ODR, 
+		PIO_MDER, PIO_MDDR, PIO_PUER, PIO_PUDR, PIO_PPDER, PIO_PPDDR, PIO_IFSCER, PIO_IFSCDR, PIO_SCHMITT;
+	RwReg PIO_ABCDSR[2];
+} Pio;
+
+typedef struct {
+	volatile uint32_t CTRL, LOAD, VAL, CALIB;
+} SysTick_Type;
+
+//One instance of everything, defined here - each test is a single translation unit.
+Uart simUART0, simUART1;
+Usart simUSART0, simUSART1;
+Pio simPIOA, simPIOB;
+SysTick_Type simSysTick;
+
+static inline uint8_t* simPointer(uint32_t reg) {
+	return (uint8_t*)(((uintptr_t)&simUART0 & ~(uintptr_t)0xFFFFFFFF) | reg);
+}
+
+#define UART0 (&simUART0)
+#define UART1 (&simUART1)
+#define USART0 (&simUSART0)
+#define USART1 (&simUSART1)
+#define PIOA (&simPIOA)
+#define PIOB (&simPIOB)
+#define SysTick (&simSysTick)
+
+#define ID_UART0 8
+#define ID_UART1 9
+#define ID_PIOA 11
+#define ID_PIOB 12
+#define ID_USART0 14
+#define ID_USART1 15
+
+enum IRQn_Type {SysTick_IRQn = -1, UART0_IRQn = 8, UART1_IRQn = 9, USART0_IRQn = 14, USART1_IRQn = 15};
+
+//Core functions do nothing: interrupts are the test calling Update(). 
+// Software-pended interrupts are noted in simPendingIRQ for the test to run.
+uint32_t simPendingIRQ;
+static inline void NVIC_EnableIRQ(IRQn_Type) {}
+static inline void NVIC_DisableIRQ(IRQn_Type) {}
+static inline void NVIC_SetPendingIRQ(IRQn_Type irq) {
+	if (irq >= 0) {
+		simPendingIRQ |= 0x1u << irq;
+	}
+}
+static inline void __WFI(void) {}
+static inline void __DMB(void) {}
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+
+#define SysTick_CTRL_ENABLE_Msk (0x1u << 0)
+#define SysTick_CTRL_TICKINT_Msk (0x1u << 1)
+#define SysTick_CTRL_COUNTFLAG_Msk (0x1u << 16)
+
+//Register bit fields, with the device header's names and values.
+#define SIM_BIT(n) (0x1u << (n))
+
+#define UART_CR_RSTRX SIM_BIT(2)
+#define UART_CR_RSTTX SIM_BIT(3)
+#define UART_CR_RXEN SIM_BIT(4)
+#define UART_CR_RXDIS SIM_BIT(5)
+#define UART_CR_TXEN SIM_BIT(6)
+#define UART_CR_TXDIS SIM_BIT(7)
+#define UART_CR_RSTSTA SIM_BIT(8)
+#define UART_MR_PAR(v) ((0x7u<<9)&((v)<<9))
+#define UART_MR_CHMODE(v) ((0x3u<<14)&((v)<<14))
+#define UART_MR_CHMODE_NORMAL (0x0u<<14)
+#define UART_BRGR_CD(v) ((0xffffu)&(v))
+#define UART_IER_RXRDY SIM_BIT(0)
+#define UART_IER_TXRDY SIM_BIT(1)
+#define UART_IER_ENDRX SIM_BIT(3)
+#define UART_IER_ENDTX SIM_BIT(4)
+#define UART_IER_OVRE SIM_BIT(5)
+#define UART_IER_FRAME SIM_BIT(6)
+#define UART_IER_PARE SIM_BIT(7)
+#define UART_IER_TXEMPTY SIM_BIT(9)
+#define UART_IER_TXBUFE SIM_BIT(11)
+#define UART_IER_RXBUFF SIM_BIT(12)
+#define UART_IDR_RXRDY SIM_BIT(0)
+#define UART_IDR_TXRDY SIM_BIT(1)
+#define UART_IDR_ENDTX SIM_BIT(4)
+#define UART_IDR_TXBUFE SIM_BIT(11)
+#define UART_IMR_TXRDY SIM_BIT(1)
+#define UART_IMR_ENDTX SIM_BIT(4)
+#define UART_IMR_TXBUFE SIM_BIT(11)
+#define UART_SR_RXRDY SIM_BIT(0)
+#define UART_SR_TXRDY SIM_BIT(1)
+#define UART_SR_ENDRX SIM_BIT(3)
+#define UART_SR_ENDTX SIM_BIT(4)
+#define UART_SR_OVRE SIM_BIT(5)
+#define UART_SR_FRAME SIM_BIT(6)
+#define UART_SR_PARE SIM_BIT(7)
+#define UART_SR_TXEMPTY SIM_BIT(9)
+#define UART_SR_TXBUFE SIM_BIT(11)
+#define UART_SR_RXBUFF SIM_BIT(12)
+#define UART_PTCR_RXTEN SIM_BIT(0)
+#define UART_PTCR_RXTDIS SIM_BIT(1)
+#define UART_PTCR_TXTEN SIM_BIT(8)
+#define UART_PTCR_TXTDIS SIM_BIT(9)
+#define UART_PTSR_TXTEN SIM_BIT(8)
+#define UART_TCR_TXCTR(v) ((0xffffu)&(v))
+#define UART_TNCR_TXNCTR(v) ((0xffffu)&(v))
+#define US_CR_RSTRX SIM_BIT(2)
+#define US_CR_RSTTX SIM_BIT(3)
+#define US_CR_RXEN SIM_BIT(4)
+#define US_CR_RXDIS SIM_BIT(5)
+#define US_CR_TXEN SIM_BIT(6)
+#define US_CR_TXDIS SIM_BIT(7)
+#define US_CR_RSTSTA SIM_BIT(8)
+#define US_CR_STTBRK SIM_BIT(9)
+#define US_CR_STPBRK SIM_BIT(10)
+#define US_CR_STTTO SIM_BIT(11)
+#define US_CR_SENDA SIM_BIT(12)
+#define US_CR_RSTIT SIM_BIT(13)
+#define US_CR_RSTNACK SIM_BIT(14)
+#define US_CR_RETTO SIM_BIT(15)
+#define US_CR_RTSEN SIM_BIT(18)
+#define US_CR_FCS SIM_BIT(18)
+#define US_CR_RTSDIS SIM_BIT(19)
+#define US_CR_RCS SIM_BIT(19)
+#define US_MR_USART_MODE_Msk (0xfu)
+#define US_MR_USART_MODE_NORMAL (0x0u)
+#define US_MR_USART_MODE_RS485 (0x1u)
+#define US_MR_USART_MODE_HW_HANDSHAKING (0x2u)
+#define US_MR_USART_MODE_SPI_MASTER (0xEu)
+#define US_MR_USCLKS_MCK (0x0u<<4)
+#define US_MR_USCLKS_SCK (0x3u<<4)
+#define US_MR_CHRL_8_BIT (0x3u<<6)
+#define US_MR_SYNC SIM_BIT(8)
+#define US_MR_CPHA SIM_BIT(8)
+#define US_MR_PAR(v) ((0x7u<<9)&((v)<<9))
+#define US_MR_PAR_MULTIDROP (0x6u<<9)
+#define US_MR_PAR_NO (0x4u<<9)
+#define US_MR_NBSTOP_1_BIT (0x0u<<12)
+#define US_MR_CHMODE_NORMAL (0x0u<<14)
+#define US_MR_MSBF SIM_BIT(16)
+#define US_MR_CPOL SIM_BIT(16)
+#define US_MR_MODE9 SIM_BIT(17)
+#define US_MR_CLKO SIM_BIT(18)
+#define US_MR_OVER SIM_BIT(19)
+#define US_MR_INACK SIM_BIT(20)
+#define US_MR_DSNACK SIM_BIT(21)
+#define US_MR_VAR_SYNC SIM_BIT(22)
+#define US_MR_INVDATA SIM_BIT(23)
+#define US_MR_FILTER SIM_BIT(28)
+#define US_MR_MAN SIM_BIT(29)
+#define US_MR_MODSYNC SIM_BIT(30)
+#define US_MR_ONEBIT SIM_BIT(31)
+#define US_IER_RXRDY SIM_BIT(0)
+#define US_IER_TXRDY SIM_BIT(1)
+#define US_IER_RXBRK SIM_BIT(2)
+#define US_IER_ENDRX SIM_BIT(3)
+#define US_IER_ENDTX SIM_BIT(4)
+#define US_IER_OVRE SIM_BIT(5)
+#define US_IER_FRAME SIM_BIT(6)
+#define US_IER_PARE SIM_BIT(7)
+#define US_IER_TIMEOUT SIM_BIT(8)
+#define US_IER_TXEMPTY SIM_BIT(9)
+#define US_IER_TXBUFE SIM_BIT(11)
+#define US_IER_RXBUFF SIM_BIT(12)
+#define US_IER_CTSIC SIM_BIT(19)
+#define US_IER_MANE SIM_BIT(24)
+#define US_IDR_RXRDY SIM_BIT(0)
+#define US_IDR_TXRDY SIM_BIT(1)
+#define US_IDR_ENDRX SIM_BIT(3)
+#define US_IDR_ENDTX SIM_BIT(4)
+#define US_IDR_OVRE SIM_BIT(5)
+#define US_IDR_FRAME SIM_BIT(6)
+#define US_IDR_PARE SIM_BIT(7)
+#define US_IDR_TIMEOUT SIM_BIT(8)
+#define US_IDR_TXEMPTY SIM_BIT(9)
+#define US_IDR_TXBUFE SIM_BIT(11)
+#define US_IDR_RXBUFF SIM_BIT(12)
+#define US_IDR_MANE SIM_BIT(24)
+#define US_IMR_RXRDY SIM_BIT(0)
+#define US_IMR_TXRDY SIM_BIT(1)
+#define US_IMR_ENDRX SIM_BIT(3)
+#define US_IMR_ENDTX SIM_BIT(4)
+#define US_IMR_TIMEOUT SIM_BIT(8)
+#define US_IMR_TXEMPTY SIM_BIT(9)
+#define US_IMR_TXBUFE SIM_BIT(11)
+#define US_IMR_RXBUFF SIM_BIT(12)
+#define US_CSR_RXRDY SIM_BIT(0)
+#define US_CSR_TXRDY SIM_BIT(1)
+#define US_CSR_RXBRK SIM_BIT(2)
+#define US_CSR_ENDRX SIM_BIT(3)
+#define US_CSR_ENDTX SIM_BIT(4)
+#define US_CSR_OVRE SIM_BIT(5)
+#define US_CSR_FRAME SIM_BIT(6)
+#define US_CSR_PARE SIM_BIT(7)
+#define US_CSR_TIMEOUT SIM_BIT(8)
+#define US_CSR_TXEMPTY SIM_BIT(9)
+#define US_CSR_TXBUFE SIM_BIT(11)
+#define US_CSR_RXBUFF SIM_BIT(12)
+#define US_CSR_CTSIC SIM_BIT(19)
+#define US_CSR_CTS SIM_BIT(23)
+#define US_CSR_MANERR SIM_BIT(24)
+#define US_RHR_RXCHR_Msk (0x1ffu)
+#define US_RHR_RXSYNH SIM_BIT(15)
+#define US_THR_TXCHR(v) ((0x1ffu)&(v))
+#define US_THR_TXSYNH SIM_BIT(15)
+#define US_BRGR_CD(v) ((0xffffu)&(v))
+#define US_BRGR_FP(v) ((0x7u<<16)&((v)<<16))
+#define US_RTOR_TO(v) ((0xffffu)&(v))
+#define US_TTGR_TG(v) ((0xffu)&(v))
+#define US_MAN_TX_PL(v) ((0xfu)&(v))
+#define US_MAN_TX_PP(v) ((0x3u<<8)&((v)<<8))
+#define US_MAN_TX_MPOL SIM_BIT(12)
+#define US_MAN_RX_PL(v) ((0xfu<<16)&((v)<<16))
+#define US_MAN_RX_PP(v) ((0x3u<<24)&((v)<<24))
+#define US_MAN_RX_MPOL SIM_BIT(28)
+#define US_MAN_ONE SIM_BIT(29)
+#define US_MAN_DRIFT SIM_BIT(30)
+#define US_PTCR_RXTEN SIM_BIT(0)
+#define US_PTCR_RXTDIS SIM_BIT(1)
+#define US_PTCR_TXTEN SIM_BIT(8)
+#define US_PTCR_TXTDIS SIM_BIT(9)
+
+#endif /* SAM_HOST_H_ */
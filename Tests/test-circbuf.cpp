@@ -0,0 +1,195 @@
+/*
+ * test-circbuf.cpp
+ * Host-side stress test of CircBuf_c as a lock-free single-producer/
+ * single-consumer ring: one thread pushes a counting sequence while another 
+ * pops it, and every element is checked on the way out.
+ *
+ * Small buffers keep both threads wrapping and colliding constantly. Covers 
+ * each overflow policy, single and bulk (PushN/PopN across the wrap) access, 
+ * and the compare-exchange arbitration between an overwriting producer and 
+ * the consumer. From the repository root:
+ *     g++ -O2 -std=gnu++11 -pthread -o test-circbuf Tests/test-circbuf.cpp
+ *     ./test-circbuf
+ * Also worth running built with -fsanitize=thread. Exit status is the 
+ * number of failed checks.
+ *
+ * Created: 17/10/2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+#include <atomic>
+
+#include "../Utilities/CircBuf.hpp"
+
+
+#define TEST_ELEMENTS 2000000 // Per test.
+
+static uint32_t testFailures;
+
+static void testCheck(bool passed, const char* name, const char* detail, uint64_t value) {
+	if (!passed) {
+		printf("FAIL %s: %s (%llu)\n", name, detail, (unsigned long long)value);
+		testFailures++;
+	}
+}
+
+//Cheap per-thread pseudo-random chunk sizes, so bulk copies split at every offset.
+static uint32_t testRandom(uint32_t* state) {
+	*state = *state * 1664525 + 1013904223;
+	return *state >> 16;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Lossless policies: the consumer must see every element, in order.
+
+template <uint32_t Policy, bool Bulk>
+static void testLossless(const char* name) {
+	static CircBuf_c<uint32_t, 16, Policy, true> ring;
+	uint32_t failuresBefore = testFailures;
+	
+	std::thread producer([] {
+		uint32_t seed = 1;
+		uint32_t next = 0;
+		while (next < TEST_ELEMENTS) {
+			if (Bulk) {
+				uint32_t data[24];
+				uint32_t count = 1 + testRandom(&seed) % 24; // Sometimes more than fits.
+				if (count > TEST_ELEMENTS - next) {
+					count = TEST_ELEMENTS - next;
+				}
+				for (uint32_t i = 0; i < count; i++) {
+					data[i] = next + i;
+				}
+				uint32_t stored = ring.PushN(data, count); // Partial (dropNewest) or nothing (reject).
+				next += stored;
+				if (stored < count) {
+					std::this_thread::yield(); // Full: let the consumer run (matters on one core).
+				}
+			}
+			else if (ring.Push(next)) {
+				next++;
+			}
+			else {
+				std::this_thread::yield();
+			}
+		}
+	});
+	
+	uint32_t seed = 2;
+	uint32_t expected = 0;
+	while (expected < TEST_ELEMENTS) {
+		uint32_t data[24];
+		uint32_t count = Bulk ? ring.PopN(data, 1 + testRandom(&seed) % 24) : 0;
+		if (!Bulk && ring.Available()) {
+			data[0] = ring.Pop();
+			count = 1;
+		}
+		if (count == 0) {
+			std::this_thread::yield();
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			if (data[i] != expected) {
+				testCheck(false, name, "out of sequence at element", expected);
+				producer.join();
+				return;
+			}
+			expected++;
+		}
+	}
+	producer.join();
+	testCheck(ring.Available() == 0, name, "left over", ring.Available());
+	testCheck(ring.HighWaterMark() <= 16, name, "high water mark beyond size", ring.HighWaterMark());
+	if (testFailures == failuresBefore) {
+		printf("PASS %s\n", name);
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Overwrite-oldest: the producer never waits and retires the oldest element 
+// itself, racing the consumer's compare-exchange. Elements may go missing, 
+// but what arrives must be genuine, in order, and never duplicated.
+
+template <bool Bulk>
+static void testOverwrite(const char* name) {
+	static CircBuf_c<uint32_t, 16, circbuf_overwriteOldest, true> ring;
+	static std::atomic<bool> finished(false);
+	
+	finished = false;
+	std::thread producer([] {
+		uint32_t seed = 3;
+		uint32_t next = 1; // 0 is what Pop() returns on empty.
+		while (next <= TEST_ELEMENTS) {
+			if (Bulk) {
+				uint32_t data[40];
+				uint32_t count = 1 + testRandom(&seed) % 40; // Up to more than the whole ring.
+				if (count > TEST_ELEMENTS + 1 - next) {
+					count = TEST_ELEMENTS + 1 - next;
+				}
+				for (uint32_t i = 0; i < count; i++) {
+					data[i] = next + i;
+				}
+				ring.PushN(data, count);
+				next += count;
+			}
+			else {
+				ring.Push(next++);
+			}
+			if ((next & 0xFF) == 0) {
+				std::this_thread::yield(); // Give a single-core host's consumer a turn.
+			}
+		}
+		finished = true;
+	});
+	
+	uint32_t seed = 4;
+	uint32_t last = 0;
+	uint64_t received = 0;
+	uint32_t failuresBefore = testFailures;
+	bool failed = false;
+	while (!failed && !(finished && ring.Available() == 0)) {
+		uint32_t data[24];
+		uint32_t count = Bulk ? ring.PopN(data, 1 + testRandom(&seed) % 24) : 0;
+		if (!Bulk && ring.Available()) {
+			data[0] = ring.Pop();
+			count = (data[0] != 0);
+		}
+		if (count == 0) {
+			std::this_thread::yield();
+		}
+		for (uint32_t i = 0; i < count && !failed; i++) {
+			if (data[i] <= last) {
+				testCheck(false, name, "element repeated or out of order", data[i]);
+				failed = true;
+			}
+			last = data[i];
+			received++;
+		}
+	}
+	producer.join();
+	
+	//Pushes only count drops they actually made - not elements the consumer 
+	// took first - so the books balance exactly.
+	uint64_t accounted = received + ring.DroppedCount();
+	testCheck(accounted == TEST_ELEMENTS, name, "received + dropped != pushed", accounted);
+	testCheck(received > 0, name, "consumer starved", received);
+	if (testFailures == failuresBefore) {
+		printf("PASS %s (%llu of %u received)\n", name, (unsigned long long)received, TEST_ELEMENTS);
+	}
+}
+
+
+int main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	testLossless<circbuf_reject, false>("circbuf_reject_push_pop");
+	testLossless<circbuf_reject, true>("circbuf_reject_pushn_popn");
+	testLossless<circbuf_dropNewest, false>("circbuf_dropnewest_push_pop");
+	testLossless<circbuf_dropNewest, true>("circbuf_dropnewest_pushn_popn");
+	testOverwrite<false>("circbuf_overwrite_push_pop");
+	testOverwrite<true>("circbuf_overwrite_pushn_popn");
+	
+	return testFailures;
+}
@@ -0,0 +1,191 @@
+/*
+ * test-serial-format.cpp
+ * Host-side check of SerialStream's real number formatting (%f and %e),
+ * which takes floats and doubles apart itself instead of using the C
+ * library. Fixed cases cover the edges: doubles beyond single precision's
+ * range both ways, subnormals, rounding up to the next power of ten, and the
+ * 2^64 switch from fixed to exponent notation. A sweep over random bit
+ * patterns then checks %e against the true value across the whole range.
+ * From the repository root:
+ *     g++ -O2 -std=gnu++11 -o test-serial-format Tests/test-serial-format.cpp
+ *     ./test-serial-format
+ * Exit status is the number of failed checks.
+ *
+ * Created: 17/10/2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "../Utilities/serial-funcs.hpp"
+
+
+static uint32_t testFailures;
+
+static void testCheck(bool passed, const char* name, const char* detail, const char* text) {
+	if (!passed) {
+		printf("FAIL %s: %s (%s)\n", name, detail, text);
+		testFailures++;
+	}
+}
+
+static void testReport(const char* name, uint32_t failuresBefore) {
+	if (testFailures == failuresBefore) {
+		printf("PASS %s\n", name);
+	}
+}
+
+static uint64_t testRandom(uint64_t* state) {
+	*state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return *state;
+}
+
+//Print() goes through the type-safe path, where floats stay floats.
+class testStream_c: public SerialStream {
+	public:
+		int16_t Read(void) { return -1; }
+		int16_t Peek(void) { return -1; }
+		uint32_t Available(void) { return 0; }
+		void Write(uint8_t byte) { this->WriteBlock(&byte, 1); }
+		uint32_t WriteBlock(const uint8_t* data, uint32_t num_bytes) {
+			memcpy(this->text + this->length, data, num_bytes);
+			this->length += num_bytes;
+			this->text[this->length] = '\0';
+			return num_bytes;
+		}
+		char text[256];
+		uint32_t length;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+//Fixed cases, through snprintf (so floats arrive promoted to double).
+
+struct testCase_t {
+	const char* format;
+	double value;
+	const char* expected;
+};
+
+static const testCase_t testCases[] = {
+	//Beyond single precision: these used to reach an out-of-range shift.
+	{"%e", 1e300, "1.000000e+300"},
+	{"%e", -2.5e100, "-2.500000e+100"},
+	{"%f", -2.5e100, "-2.500000e+100"},
+	{"%e", 3.5e38, "3.500000e+38"},
+	{"%.2e", DBL_MAX, "1.80e+308"},
+	{"%e", -DBL_MAX, "-1.797693e+308"},
+	//Tiny and subnormal doubles: these used to flush to zero.
+	{"%e", 1e-300, "1.000000e-300"},
+	{"%e", 1e-38, "1.000000e-38"},
+	{"%e", 1e-45, "1.000000e-45"},
+	{"%e", DBL_MIN, "2.225074e-308"},
+	{"%e", 4.9406564584124654e-324, "4.940656e-324"},
+	{"%e", -2.2250738585072009e-308, "-2.225074e-308"},
+	{"%f", 1e-300, "0.000000"},
+	//Rounding carries into the next digit, or the next power of ten.
+	{"%e", 9.9999999, "1.000000e+01"},
+	{"%f", 9.9999999, "10.000000"},
+	{"%.2f", 9.999, "10.00"},
+	{"%.0e", 9.999, "1e+01"},
+	{"%e", 0.99999999, "1.000000e+00"},
+	//Largest whole part fixed notation takes, then exponent notation from 2^64.
+	{"%f", 18446744073709549568.0, "18446744073709549568.000000"},
+	{"%f", 18446744073709551616.0, "1.844674e+19"},
+	{"%e", 18446744073709551616.0, "1.844674e+19"},
+	//Ordinary values, zero and the specials.
+	{"%e", 123.456, "1.234560e+02"},
+	{"%.3f", -0.0625, "-0.063"},
+	{"%e", 0.0, "0.000000e+00"},
+	{"%f", -0.0, "-0.000000"},
+	{"%e", INFINITY, "inf"},
+	{"%f", -INFINITY, "-inf"},
+	{"%e", NAN, "nan"},
+};
+
+static void testFixedCases(void) {
+	const char* name = "format_edge_cases";
+	uint32_t failuresBefore = testFailures;
+
+	for (uint32_t i = 0; i < sizeof(testCases) / sizeof(testCases[0]); i++) {
+		char text[64];
+		SerialStream::snprintf(text, sizeof(text), testCases[i].format, testCases[i].value);
+		if (strcmp(text, testCases[i].expected) != 0) {
+			char detail[96];
+			::snprintf(detail, sizeof(detail), "%s of %.17g expected %s", testCases[i].format,
+				testCases[i].value, testCases[i].expected);
+			testCheck(false, name, detail, text);
+		}
+	}
+	testReport(name, failuresBefore);
+}
+
+//Floats through Print(), which formats them without promotion.
+static void testFloatCases(void) {
+	const char* name = "format_float_cases";
+	uint32_t failuresBefore = testFailures;
+	static const float values[] = {FLT_MAX, FLT_MIN, 1.4e-45f, -1e-40f, 1e20f};
+	static const char* expected[] = {"3.402823e+38", "1.175494e-38", "1.401298e-45", "-9.999946e-41", "1.000000e+20"};
+
+	for (uint32_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+		testStream_c stream;
+		stream.length = 0;
+		stream.Print("%e", values[i]);
+		testCheck(strcmp(stream.text, expected[i]) == 0, name, expected[i], stream.text);
+	}
+	testReport(name, failuresBefore);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Random doubles across the whole range: %e must read back within its
+// precision (7 digits from a float, plus rounding) and keep its shape.
+
+static void testRandomSweep(void) {
+	const char* name = "format_random_sweep";
+	uint32_t failuresBefore = testFailures;
+	uint64_t seed = 11;
+
+	for (uint32_t i = 0; i < 1000000 && testFailures - failuresBefore < 10; i++) {
+		uint64_t bits = testRandom(&seed);
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		if (isnan(value) || isinf(value)) {
+			continue;
+		}
+
+		char text[64];
+		SerialStream::snprintf(text, sizeof(text), "%e", value);
+		const char* digits = (text[0] == '-') ? text + 1 : text;
+		bool shape = (digits[0] >= '1' && digits[0] <= '9') || (value == 0.0);
+		shape = shape && digits[1] == '.' && digits[8] == 'e' && (text[0] == '-') == (signbit(value) != 0);
+		testCheck(shape, name, "malformed", text);
+
+		double error = fabs(strtod(text, NULL) - value);
+		testCheck(error <= fabs(value) * 1e-6, name, "value differs", text);
+	}
+
+	//And %f below 2^64, where the whole part is exact. The fraction is cut to 
+	// 32 bits before rounding, which can tip a near-half case the wrong way.
+	for (uint32_t i = 0; i < 1000000 && testFailures - failuresBefore < 10; i++) {
+		double value = ldexp((double)(testRandom(&seed) >> 11), (int)(testRandom(&seed) % 128) - 117);
+		char text[64];
+		SerialStream::snprintf(text, sizeof(text), "%f", value);
+		double error = fabs(strtod(text, NULL) - value);
+		testCheck(error <= 5e-7 + ldexp(1.0, -32) + fabs(value) * 1e-15, name, "fixed value differs", text);
+	}
+	testReport(name, failuresBefore);
+}
+
+
+int main(void) {
+	testFixedCases();
+	testFloatCases();
+	testRandomSweep();
+
+	return testFailures;
+}
@@ -0,0 +1,148 @@
+/*
+ * test-serial-line.cpp
+ * Host-side check of the drivers' shared line framing (serialLineGet and
+ * serialLineRelease) on a small overwrite-oldest ring, like their receive
+ * buffers. The interesting cases are the producer overwriting data the line
+ * framing is part-way through: a held line, and a partly searched one.
+ * From the repository root:
+ *     g++ -O2 -std=gnu++11 -o test-serial-line Tests/test-serial-line.cpp
+ *     ./test-serial-line
+ * Exit status is the number of failed checks.
+ *
+ * Created: 17/10/2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../Utilities/CircBuf.hpp"
+#include "../Utilities/serial-funcs.hpp"
+
+
+typedef CircBuf_c<uint8_t, 16, circbuf_overwriteOldest, true> testRing_t;
+
+static uint32_t testFailures;
+
+static void testCheck(bool passed, const char* name, const char* detail, const char* text) {
+	if (!passed) {
+		printf("FAIL %s: %s (%s)\n", name, detail, text);
+		testFailures++;
+	}
+}
+
+static void testReport(const char* name, uint32_t failuresBefore) {
+	if (testFailures == failuresBefore) {
+		printf("PASS %s\n", name);
+	}
+}
+
+//A fresh ring and line state, as a driver's constructor leaves them.
+struct testLink_t {
+	testRing_t ring;
+	serialLineState_t state;
+
+	testLink_t() : state() {
+		this->state.delimiter = '\n';
+		this->state.maxLength = 15;
+	}
+	void Receive(const char* text) {
+		this->ring.PushN((const uint8_t*)text, strlen(text));
+	}
+	//Next line as a string, or "" if there is none.
+	const char* Get(char* text) {
+		serialLine_t line;
+		text[0] = '\0';
+		if (serialLineGet(&this->ring, &this->state, &line)) {
+			memcpy(text, line.span[0], line.spanLength[0]);
+			memcpy(text + line.spanLength[0], line.span[1], line.spanLength[1]);
+			text[line.length] = '\0';
+		}
+		return text;
+	}
+	bool Release(void) {
+		return serialLineRelease(&this->ring, &this->state);
+	}
+};
+
+
+static void testOrdinary(void) {
+	const char* name = "line_ordinary";
+	uint32_t failuresBefore = testFailures;
+	testLink_t link;
+	char text[32];
+
+	//Lines arriving in pieces, and wrapping the end of the ring.
+	for (uint32_t i = 0; i < 10; i++) {
+		link.Receive("ab");
+		testCheck(strcmp(link.Get(text), "") == 0, name, "line before its delimiter", text);
+		link.Receive("cdef\n");
+		testCheck(strcmp(link.Get(text), "abcdef") == 0, name, "line", text);
+		testCheck(link.Release(), name, "intact line reported overwritten", text);
+	}
+
+	//Too long: dropped whole, and the next line still found.
+	link.Receive("0123456789abcdef");
+	link.Get(text);
+	link.Receive("gh\nok\n");
+	testCheck(strcmp(link.Get(text), "ok") == 0, name, "line after overlong one", text);
+	testCheck(link.state.discarded == 1, name, "overlong line not counted", text);
+	link.Release();
+	testReport(name, failuresBefore);
+}
+
+static void testHeldOverwritten(void) {
+	const char* name = "line_held_overwritten";
+	uint32_t failuresBefore = testFailures;
+	testLink_t link;
+	char text[32];
+
+	//Held line partly overwritten by a longer one: release must report it,
+	// and only retire what the held line occupied - not count on from the
+	// moved read index into the next line.
+	link.Receive("abc\n");
+	testCheck(strcmp(link.Get(text), "abc") == 0, name, "first line", text);
+	link.Receive("set 12345678\n");
+	testCheck(!link.Release(), name, "overwritten line reported intact", text);
+	testCheck(link.state.overrun == 1, name, "overrun not counted", text);
+	testCheck(strcmp(link.Get(text), "set 12345678") == 0, name, "next line eaten into", text);
+	testCheck(link.Release(), name, "next line reported overwritten", text);
+
+	//Held line overwritten completely: nothing of the next line is lost.
+	link.Receive("xy\n");
+	link.Get(text);
+	link.Receive("0123456789ab\nz\n");
+	testCheck(!link.Release(), name, "overwritten line reported intact", text);
+	testCheck(strcmp(link.Get(text), "0123456789ab") == 0, name, "line after overrun", text);
+	link.Release();
+	testCheck(strcmp(link.Get(text), "z") == 0, name, "last line", text);
+	link.Release();
+	testReport(name, failuresBefore);
+}
+
+static void testScannedStale(void) {
+	const char* name = "line_scanned_stale";
+	uint32_t failuresBefore = testFailures;
+	testLink_t link;
+	char text[32];
+
+	//A partial line searched once, then overwritten from the front: the
+	// search must restart from the new read index, not skip the old count.
+	link.Receive("partial-");
+	testCheck(strcmp(link.Get(text), "") == 0, name, "line before its delimiter", text);
+	link.Receive("xxxxxx\nab\n"); // 8 + 10 > 16: two bytes retired.
+	testCheck(strcmp(link.Get(text), "rtial-xxxxxx") == 0, name, "line from moved read index", text);
+	link.Release();
+	testCheck(strcmp(link.Get(text), "ab") == 0, name, "following line", text);
+	link.Release();
+	testReport(name, failuresBefore);
+}
+
+
+int main(void) {
+	testOrdinary();
+	testHeldOverwritten();
+	testScannedStale();
+
+	return testFailures;
+}
@@ -0,0 +1,98 @@
+/*
+ * test-serial-parse.cpp
+ * Host-side check of serialParser_c, fed a line in pieces the way receive
+ * interrupts deliver it, and fed bytes no number can contain. A 0xFF in
+ * the middle of a number is line noise on a UART: it must end the number
+ * like any other non-digit, through the last entry of SerialAsciiInverse.
+ * Build with -fsanitize=address to catch reads past that table.
+ * From the repository root:
+ *     g++ -O2 -std=gnu++11 -o test-serial-parse Tests/test-serial-parse.cpp
+ *     ./test-serial-parse
+ * Exit status is the number of failed checks.
+ *
+ * Created: 17/10/2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../Utilities/serial-parse.hpp"
+
+
+static uint32_t testFailures;
+
+static void testCheck(bool passed, const char* name, const char* detail, int64_t value) {
+	if (!passed) {
+		printf("FAIL %s: %s (%lld)\n", name, detail, (long long)value);
+		testFailures++;
+	}
+}
+
+static void testReport(const char* name, uint32_t failuresBefore) {
+	if (testFailures == failuresBefore) {
+		printf("PASS %s\n", name);
+	}
+}
+
+//Feeds all of text, carrying on after each field, and returns the final status.
+static uint32_t testFeed(serialParser_c* parser, const char* text, uint32_t length) {
+	uint32_t used = 0;
+	while (used < length) {
+		used += parser->Feed((const uint8_t*)text + used, length - used);
+		if (parser->Status() != serial_parseBusy && parser->Status() != serial_parseField) {
+			break;
+		}
+	}
+	return parser->Status();
+}
+
+
+static void testPieces(void) {
+	const char* name = "parse_pieces";
+	uint32_t failuresBefore = testFailures;
+	serialParser_c parser("set %s %d %x\n");
+	const char* line = "set speed -120 0x1F\n";
+
+	//One byte at a time: nothing is lost at the joins.
+	uint32_t status = serial_parseBusy;
+	for (uint32_t i = 0; line[i] != 0; i++) {
+		status = testFeed(&parser, line + i, 1);
+	}
+	testCheck(status == serial_parseDone, name, "status", status);
+	testCheck(strcmp(parser.Text(0), "speed") == 0, name, "word", 0);
+	testCheck(parser.Value(1) == -120, name, "decimal", parser.Value(1));
+	testCheck(parser.Value(2) == 0x1F, name, "hex", parser.Value(2));
+	testReport(name, failuresBefore);
+}
+
+static void testHighByte(void) {
+	const char* name = "parse_high_byte";
+	uint32_t failuresBefore = testFailures;
+	serialParser_c parser("%d");
+
+	//0xFF ends the number, and is left for the next call.
+	const char noisy[] = "12\xFF" "34";
+	uint32_t used = parser.Feed((const uint8_t*)noisy, 5);
+	testCheck(parser.Status() == serial_parseDone, name, "number not ended by 0xFF", parser.Status());
+	testCheck(parser.Value(0) == 12, name, "value", parser.Value(0));
+	testCheck(used == 2, name, "0xFF consumed as a digit", used);
+
+	//Where the format wants a separator, 0xFF is an error, not a digit.
+	parser.Begin("%x %x");
+	testCheck(testFeed(&parser, "ab\xFF" "cd ", 6) == serial_parseError, name, "0xFF matched a space", parser.Status());
+	testCheck(parser.Value(0) == 0xAB, name, "hex before 0xFF", parser.Value(0));
+
+	//And before any digits, it is not a number at all.
+	parser.Begin("%u");
+	testCheck(testFeed(&parser, "\xFF" "7", 2) == serial_parseError, name, "leading 0xFF accepted", parser.Status());
+	testReport(name, failuresBefore);
+}
+
+
+int main(void) {
+	testPieces();
+	testHighByte();
+
+	return testFailures;
+}
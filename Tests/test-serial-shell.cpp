@@ -0,0 +1,106 @@
+/*
+ * test-serial-shell.cpp
+ * Host-side check of serialShell_c's dispatch and argument parsing, through
+ * Execute() as Poll() calls it. Arguments are untrusted line input: a 0xFF
+ * byte from line noise must make ArgInt/ArgHex refuse the argument, through
+ * the last entry of SerialAsciiInverse. Build with -fsanitize=address to
+ * catch reads past that table.
+ * From the repository root:
+ *     g++ -O2 -std=gnu++11 -o test-serial-shell Tests/test-serial-shell.cpp
+ *     ./test-serial-shell
+ * Exit status is the number of failed checks.
+ *
+ * Created: 17/10/2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../Utilities/serial-shell.hpp"
+
+
+static uint32_t testFailures;
+
+static void testCheck(bool passed, const char* name, const char* detail, int64_t value) {
+	if (!passed) {
+		printf("FAIL %s: %s (%lld)\n", name, detail, (long long)value);
+		testFailures++;
+	}
+}
+
+static void testReport(const char* name, uint32_t failuresBefore) {
+	if (testFailures == failuresBefore) {
+		printf("PASS %s\n", name);
+	}
+}
+
+
+//What the "set" handler last made of its arguments.
+static bool testIntOk;
+static bool testHexOk;
+static int32_t testInt;
+static uint32_t testHex;
+
+static void testCmdSet(serialShell_c* shell) {
+	testIntOk = shell->ArgInt(1, &testInt);
+	testHexOk = shell->ArgHex(2, &testHex);
+}
+
+constexpr serialCommand_t testCommands[] = {
+	{"get", NULL, NULL},
+	{"set", testCmdSet, "set <int> <hex>"},
+};
+SERIAL_SHELL_CHECK(testCommands);
+
+static serialShell_c testShell(testCommands, sizeof(testCommands) / sizeof(testCommands[0]));
+
+//Runs one line, as Poll() would after copying it out of the receive buffer.
+static uint32_t testExecute(const char* text) {
+	char line[SERIAL_SHELL_LINE_LENGTH + 1];
+	uint32_t length = strlen(text);
+	memcpy(line, text, length);
+	testIntOk = testHexOk = false;
+	return testShell.Execute(line, length, NULL);
+}
+
+
+static void testArguments(void) {
+	const char* name = "shell_arguments";
+	uint32_t failuresBefore = testFailures;
+
+	testCheck(testExecute("set -42 0x1f") == serial_shellOk, name, "set not run", 0);
+	testCheck(testIntOk && testInt == -42, name, "decimal", testInt);
+	testCheck(testHexOk && testHex == 0x1F, name, "hex", testHex);
+	testCheck(testExecute("set 0xFFFFFFFF ffffffff") == serial_shellOk, name, "set not run", 0);
+	testCheck(testIntOk && testInt == -1, name, "full-width prefixed int", testInt);
+	testCheck(testHexOk && testHex == 0xFFFFFFFF, name, "full-width hex", testHex);
+	testCheck(testExecute("set 2147483648 100000000") == serial_shellOk, name, "set not run", 0);
+	testCheck(!testIntOk, name, "decimal over INT32_MAX accepted", testInt);
+	testCheck(!testHexOk, name, "hex over 32 bits accepted", testHex);
+	testCheck(testExecute("  \t") == serial_shellEmpty, name, "blank line", 0);
+	testCheck(testExecute("sex 1") == serial_shellUnknown, name, "unknown command", 0);
+	testReport(name, failuresBefore);
+}
+
+static void testHighByte(void) {
+	const char* name = "shell_high_byte";
+	uint32_t failuresBefore = testFailures;
+
+	//0xFF inside, after and in place of the digits: never a digit.
+	testCheck(testExecute("set 1\xFF" "2 a\xFF") == serial_shellOk, name, "set not run", 0);
+	testCheck(!testIntOk, name, "int with 0xFF accepted", testInt);
+	testCheck(!testHexOk, name, "hex with 0xFF accepted", testHex);
+	testCheck(testExecute("set -\xFF 0x\xFF") == serial_shellOk, name, "set not run", 0);
+	testCheck(!testIntOk, name, "0xFF alone as int accepted", testInt);
+	testCheck(!testHexOk, name, "0xFF alone as hex accepted", testHex);
+	testReport(name, failuresBefore);
+}
+
+
+int main(void) {
+	testArguments();
+	testHighByte();
+
+	return testFailures;
+}
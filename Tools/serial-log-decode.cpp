@@ -0,0 +1,268 @@
+/*
+ * serial-log-decode.cpp
+ * Host-side decoder for SERIAL_LOG records (see Utilities/serial-log.hpp).
+ *
+ * Reads the format strings from the "serial_log" section of the firmware ELF 
+ * file, then turns the binary log captured from the serial port back into 
+ * text, using the library's own formatter so output matches printf on target.
+ * From the repository root:
+ *     g++ -O2 -std=gnu++11 -o serial-log-decode Tools/serial-log-decode.cpp
+ *     stty -F /dev/ttyUSB0 115200 raw
+ *     ./serial-log-decode firmware.elf < /dev/ttyUSB0
+ * A capture file can be given as a second argument instead of stdin.
+ *
+ * Created: 17/10/2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <elf.h>
+#include <vector>
+
+#include "../Utilities/serial-funcs.hpp"
+
+
+//////////////////////////////////////////////////////////////////////////
+//Output stream for the library formatter:
+
+class stdoutStream_c: public SerialStream {
+	public:
+		uint32_t Available(void) { return 0; }
+		int16_t Read(void) { return -1; }
+		int16_t Peek(void) { return -1; }
+		void Write(uint8_t byte) { fputc(byte, stdout); }
+		uint32_t WriteBlock(const uint8_t* data, uint32_t num_bytes) { return fwrite(data, 1, num_bytes, stdout); }
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+//Format string table from the ELF file (32-bit target, or 64-bit for host tests):
+
+//True if size bytes from offset are all within the file.
+static bool elfInFile(const std::vector<uint8_t>& elf, uint64_t offset, uint64_t size) {
+	return offset <= elf.size() && size <= elf.size() - offset;
+}
+
+//The header is only trusted as far as it stays inside the file: a truncated 
+// or damaged ELF is refused with a message, not read past its end.
+template <typename Ehdr_t, typename Shdr_t>
+static bool elfSection(const std::vector<uint8_t>& elf, const char* name, std::vector<char>* section) {
+	if (!elfInFile(elf, 0, sizeof(Ehdr_t))) {
+		fprintf(stderr, "serial-log-decode: ELF header truncated\n");
+		return false;
+	}
+	const Ehdr_t* header = (const Ehdr_t*)&elf[0];
+	if (header->e_shentsize != sizeof(Shdr_t) 
+			|| !elfInFile(elf, header->e_shoff, (uint64_t)header->e_shnum * header->e_shentsize)) {
+		fprintf(stderr, "serial-log-decode: section headers outside the file\n");
+		return false;
+	}
+	if (header->e_shstrndx >= header->e_shnum) {
+		fprintf(stderr, "serial-log-decode: no section name table\n");
+		return false;
+	}
+	const Shdr_t* sections = (const Shdr_t*)&elf[header->e_shoff];
+	const Shdr_t* names = &sections[header->e_shstrndx];
+	if (!elfInFile(elf, names->sh_offset, names->sh_size)) {
+		fprintf(stderr, "serial-log-decode: section name table outside the file\n");
+		return false;
+	}
+
+	uint32_t nameLength = strlen(name);
+	for (uint32_t i = 0; i < header->e_shnum; i++) {
+		//Name plus terminator must fit in the name table.
+		if (sections[i].sh_name >= names->sh_size || names->sh_size - sections[i].sh_name <= nameLength 
+				|| memcmp(&elf[names->sh_offset + sections[i].sh_name], name, nameLength + 1) != 0) {
+			continue;
+		}
+		if (sections[i].sh_type == SHT_NOBITS) {
+			fprintf(stderr, "serial-log-decode: %s has no contents in the file (NOLOAD?) - use (INFO) instead\n", name);
+			return false;
+		}
+		if (sections[i].sh_type != SHT_PROGBITS || !elfInFile(elf, sections[i].sh_offset, sections[i].sh_size)) {
+			fprintf(stderr, "serial-log-decode: %s section damaged\n", name);
+			return false;
+		}
+		section->assign(elf.begin() + sections[i].sh_offset, elf.begin() + sections[i].sh_offset + sections[i].sh_size);
+		section->push_back('\0');
+		return true;
+	}
+	return false;
+}
+
+static bool loadFormats(const char* path, std::vector<char>* formats) {
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		return false;
+	}
+	std::vector<uint8_t> elf;
+	uint8_t chunk[4096];
+	size_t got;
+	while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+		elf.insert(elf.end(), chunk, chunk + got);
+	}
+	fclose(file);
+
+	if (elf.size() < EI_NIDENT || memcmp(&elf[0], ELFMAG, SELFMAG) != 0) {
+		return false;
+	}
+	if (elf[EI_CLASS] == ELFCLASS32) {
+		return elfSection<Elf32_Ehdr, Elf32_Shdr>(elf, "serial_log", formats);
+	}
+	return elfSection<Elf64_Ehdr, Elf64_Shdr>(elf, "serial_log", formats);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Record decoding:
+
+static bool readVarint(const uint8_t** ptr, const uint8_t* end, uint64_t* value) {
+	*value = 0;
+	for (uint32_t shift = 0; *ptr < end && shift < 64; shift += 7) {
+		uint8_t byte = *((*ptr)++);
+		*value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//Walks the format, pulling each argument from the record as its specifier says.
+static void decodeRecord(stdoutStream_c* out, const std::vector<char>& formats, const uint8_t* ptr, const uint8_t* end) {
+	uint64_t id;
+	if (!readVarint(&ptr, end, &id) || id >= formats.size()) {
+		fprintf(stderr, "serial-log-decode: unknown record ID\n");
+		return;
+	}
+
+	const char* format = &formats[id];
+	while (*format) {
+		const char* text = format;
+		while (*format && *format != '%') {
+			format++;
+		}
+		out->WriteBlock((const uint8_t*)text, format - text);
+		if (*format == 0) {
+			break;
+		}
+		if (format[1] == '%') {
+			out->Write('%');
+			format += 2;
+			continue;
+		}
+
+		//One specifier, passed on with its precision to Print():
+		char spec[16];
+		const char* letter = serialSpecLetter(format + 1);
+		uint32_t specLength = letter + 1 - format;
+		if (*letter == 0 || specLength >= sizeof(spec)) {
+			break;
+		}
+		memcpy(spec, format, specLength);
+		spec[specLength] = '\0';
+		format = letter + 1;
+
+		uint64_t value;
+		if (*letter == 's') {
+			// Longer than any record the target builds (SERIAL_LOG_RECORD_LENGTH): damaged.
+			char text[256];
+			if (!readVarint(&ptr, end, &value) || value > (uint64_t)(end - ptr) || value >= sizeof(text)) {
+				out->Print("<?>");
+				continue;
+			}
+			memcpy(text, ptr, value);
+			text[value] = '\0';
+			ptr += value;
+			out->Print(spec, (const char*)text);
+		}
+		else if (*letter == 'f' || *letter == 'e') {
+			if (end - ptr < 4) {
+				out->Print("<?>");
+				continue;
+			}
+			uint32_t bits = ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+			float real;
+			memcpy(&real, &bits, sizeof(real));
+			ptr += 4;
+			out->Print(spec, real);
+		}
+		else {
+			if (!readVarint(&ptr, end, &value)) {
+				out->Print("<?>");
+				continue;
+			}
+			int64_t number = (int64_t)(value >> 1) ^ -(int64_t)(value & 1); // Undo zigzag.
+			if (*letter == 'd' || *letter == 'i' || *letter == 'q' || *letter == 'Q') {
+				out->Print(spec, number);
+			}
+			else {
+				out->Print(spec, (uint64_t)number);
+			}
+		}
+	}
+	fflush(stdout);
+}
+
+//Undoes COBS in place. Returns decoded length, or -1 if the record is damaged.
+static int32_t unCOBS(uint8_t* data, uint32_t length) {
+	uint32_t in = 0;
+	uint32_t out = 0;
+
+	while (in < length) {
+		uint8_t code = data[in++];
+		if (code == 0 || in + code - 1 > length) {
+			return -1;
+		}
+		for (uint32_t i = 1; i < code; i++) {
+			data[out++] = data[in++];
+		}
+		if (code < 0xFF && in < length) {
+			data[out++] = 0x00;
+		}
+	}
+	return out;
+}
+
+
+int main(int argc, char** argv) {
+	std::vector<char> formats;
+	static stdoutStream_c out;
+
+	if (argc < 2 || !loadFormats(argv[1], &formats)) {
+		fprintf(stderr, "usage: serial-log-decode firmware.elf [capture.bin]\n"
+			"  (the ELF file must contain a serial_log section)\n");
+		return 1;
+	}
+	FILE* input = (argc > 2) ? fopen(argv[2], "rb") : stdin;
+	if (!input) {
+		fprintf(stderr, "serial-log-decode: can't open %s\n", argv[2]);
+		return 1;
+	}
+
+	//Split the stream on 0x00 delimiters. Anything before the first is a partial record.
+	uint8_t record[512];
+	uint32_t length = 0;
+	bool synced = false;
+	int byte;
+	while ((byte = fgetc(input)) != EOF) {
+		if (byte != 0x00) {
+			if (length < sizeof(record)) {
+				record[length] = byte;
+			}
+			length++;
+			continue;
+		}
+		int32_t decoded = (length <= sizeof(record)) ? unCOBS(record, length) : -1;
+		if (synced && decoded > 0) {
+			decodeRecord(&out, formats, record, record + decoded);
+		}
+		else if (synced) {
+			fprintf(stderr, "serial-log-decode: damaged record skipped\n");
+		}
+		synced = true;
+		length = 0;
+	}
+	return 0;
+}
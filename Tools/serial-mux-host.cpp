@@ -0,0 +1,156 @@
+/*
+ * serial-mux-host.cpp
+ * PC end of serialMux_c (see Utilities/serial-mux.hpp).
+ *
+ * Opens the serial port, shows one channel (the console, channel 0 unless 
+ * given) on stdout and sends stdin to it, and appends every other channel's 
+ * data to mux-channel-N.bin in the current directory - e.g. follow a 
+ * SERIAL_LOG channel with
+ *     tail -c +1 -f mux-channel-2.bin | ./serial-log-decode firmware.elf
+ * Built with the library's own packet code, from the repository root:
+ *     g++ -O2 -std=gnu++11 -o serial-mux-host Tools/serial-mux-host.cpp
+ *     ./serial-mux-host /dev/ttyUSB0 115200 [console channel]
+ *
+ * Created: 17/10/2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../Utilities/serial-mux.hpp"
+
+
+//////////////////////////////////////////////////////////////////////////
+//Serial port as a SerialStream, for serialPacket_c:
+
+class fdStream_c: public SerialStream {
+	public:
+		fdStream_c(int fd) : fd(fd) {}
+		uint32_t Available(void) { return 0; }
+		int16_t Read(void) { return -1; }
+		int16_t Peek(void) { return -1; }
+		void Write(uint8_t byte) { this->WriteBlock(&byte, 1); }
+		uint32_t WriteBlock(const uint8_t* data, uint32_t num_bytes) {
+			uint32_t sent = 0;
+			while (sent < num_bytes) {
+				ssize_t count = write(this->fd, data + sent, num_bytes - sent);
+				if (count <= 0) {
+					break;
+				}
+				sent += count;
+			}
+			return sent;
+		}
+		uint32_t ReadBlock(uint8_t* data, uint32_t num_bytes) {
+			ssize_t count = read(this->fd, data, num_bytes);
+			return (count > 0) ? count : 0;
+		}
+	
+	private:
+		int fd;
+};
+
+
+static uint32_t consoleChannel = 0;
+static FILE* channelFiles[SERIAL_MUX_CHANNELS];
+
+//Received packet: channel number, then data.
+static void received(void*, const uint8_t* packet, uint32_t length) {
+	if (length == 0 || packet[0] >= SERIAL_MUX_CHANNELS) {
+		fprintf(stderr, "serial-mux-host: packet for unknown channel\n");
+		return;
+	}
+	if (packet[0] == consoleChannel) {
+		fwrite(packet + 1, 1, length - 1, stdout);
+		fflush(stdout);
+		return;
+	}
+	if (!channelFiles[packet[0]]) {
+		char name[32];
+		snprintf(name, sizeof(name), "mux-channel-%u.bin", packet[0]);
+		channelFiles[packet[0]] = fopen(name, "ab");
+	}
+	if (channelFiles[packet[0]]) {
+		fwrite(packet + 1, 1, length - 1, channelFiles[packet[0]]);
+		fflush(channelFiles[packet[0]]);
+	}
+}
+
+static speed_t baudSpeed(long baud) {
+	switch (baud) {
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		case 230400: return B230400;
+		case 460800: return B460800;
+		case 921600: return B921600;
+		default: return B0;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	if (argc < 3 || baudSpeed(atol(argv[2])) == B0) {
+		fprintf(stderr, "usage: serial-mux-host device baud [console channel]\n");
+		return 1;
+	}
+	if (argc > 3) {
+		//The device throws away packets for channels it doesn't have.
+		char* end;
+		unsigned long channel = strtoul(argv[3], &end, 10);
+		if (end == argv[3] || *end != 0 || argv[3][0] == '-' || channel >= SERIAL_MUX_CHANNELS) {
+			fprintf(stderr, "console channel must be 0 to %d\n", SERIAL_MUX_CHANNELS - 1);
+			return 1;
+		}
+		consoleChannel = channel;
+	}
+	
+	int fd = open(argv[1], O_RDWR | O_NOCTTY);
+	if (fd < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	struct termios settings;
+	tcgetattr(fd, &settings);
+	cfmakeraw(&settings);
+	// Reads return at once, even with nothing there: link.Poll() reads until 
+	//  the port is empty, and must hand back to poll() to serve stdin. Writes 
+	//  still block, so nothing sent is dropped.
+	settings.c_cc[VMIN] = 0;
+	settings.c_cc[VTIME] = 0;
+	cfsetspeed(&settings, baudSpeed(atol(argv[2])));
+	tcsetattr(fd, TCSANOW, &settings);
+	
+	fdStream_c port(fd);
+	serialPacket_c link(&port, serial_packetCOBS, serial_packetCRC16, received, NULL);
+	struct pollfd waiting[2] = {{fd, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+	
+	while (poll(waiting, 2, -1) >= 0) {
+		if (waiting[0].revents & POLLIN) {
+			link.Poll();
+		}
+		if (waiting[1].revents & (POLLIN | POLLHUP)) {
+			//Console input, in chunks the target accepts.
+			uint8_t chunk[1 + SERIAL_MUX_CHUNK];
+			ssize_t count = read(STDIN_FILENO, chunk + 1, SERIAL_MUX_CHUNK);
+			if (count <= 0) {
+				waiting[1].fd = -1; // End of input: keep listening.
+				continue;
+			}
+			chunk[0] = consoleChannel;
+			link.Send(chunk, count + 1);
+		}
+		if (waiting[0].revents & (POLLERR | POLLHUP)) {
+			break;
+		}
+	}
+	return 0;
+}
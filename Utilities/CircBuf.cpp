@@ -1,77 +1,278 @@
 /*
  * CircBuf.cpp
- * FIFO Circular Buffer with overwrite-oldest-when-full.
+ * FIFO Circular Buffer with compile-time overflow policy.
  * Based on an implementation by GitHub's yagihiro.
  *
+ * Lock-free single-producer/single-consumer: indices are only ever 
+ * incremented, element stores are published with a release store of 
+ * writePtr, and the consumer retires elements with a compare-exchange 
+ * on readPtr so that an overflowing producer can't race it.
+ *
  * Created: 14/05/2016 5:56:04 PM
  *  Author: Ben Jones
  */ 
 
 
 //Default constructor:
-template <class data_t, uint32_t BuffSize>
-CircBuf_c<data_t, BuffSize>::CircBuf_c() {
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+CircBuf_c<data_t, BuffSize, Policy, Stats>::CircBuf_c() {
 	
 	//Initialise buffer's values.
 	this->readPtr = 0;
 	this->writePtr = 0;
-	
-	//this->count = 0;
 }
 
-template <class data_t, uint32_t BuffSize>
-void CircBuf_c<data_t, BuffSize>::Push(data_t data) {
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+bool CircBuf_c<data_t, BuffSize, Policy, Stats>::Push(data_t data) {
 	//Add one value to buffer.
+	uint32_t write = this->writePtr; // Only we modify this.
+	uint32_t read = __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE);
 	
-	this->bufPtr[this->writePtr++] = data;
-	if (this->writePtr >= BuffSize) {
-		this->writePtr = 0;
-	}
-
-	// Overflow handled by overwriting oldest data.
-	if (this->writePtr == this->readPtr) {
-		this->readPtr++;
-		if (this->readPtr >= BuffSize) {
-			this->readPtr = 0;
+	//Policy is a template constant, so only one of these branches is compiled in.
+	if (write - read >= BuffSize) {
+		if (Policy == circbuf_overwriteOldest) {
+			// Retire the oldest element before its slot is reused; 
+			//  if this fails the consumer just popped it.
+			if (__atomic_compare_exchange_n(&this->readPtr, &read, read + 1, false, 
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				this->statsDropped(1);
+				read++; // For high-water mark below.
+			}
+		}
+		else {
+			if (Policy == circbuf_dropNewest) {
+				this->statsDropped(1);
+			}
+			return false;
 		}
 	}
-	/*else {
-		this->count++;
-	}*/
+	
+	this->bufPtr[write & indexMask] = data;
+	__atomic_store_n(&this->writePtr, write + 1, __ATOMIC_RELEASE); // Publish.
+	
+	this->statsLevel(write + 1 - read);
+	return true;
 }
 
-template <class data_t, uint32_t BuffSize>
-data_t CircBuf_c<data_t, BuffSize>::Pop(void) {
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+data_t CircBuf_c<data_t, BuffSize, Policy, Stats>::Pop(void) {
 	//Read one value from buffer.
 	data_t read_data = 0;
-	if (this->Available()) {
-		read_data = this->bufPtr[this->readPtr++];
-		if (this->readPtr >= BuffSize) {
-			this->readPtr = 0;
+	uint32_t read = __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE);
+	
+	do {
+		if (__atomic_load_n(&this->writePtr, __ATOMIC_ACQUIRE) == read) {
+			return 0; // Empty.
 		}
-		//this->count--;
-	}
+		read_data = this->bufPtr[read & indexMask];
+		// If the producer overwrote this element meanwhile, read is reloaded and we retry.
+	} while (!__atomic_compare_exchange_n(&this->readPtr, &read, read + 1, false, 
+		__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+	
 	return read_data;
 }
 
-template <class data_t, uint32_t BuffSize>
-data_t CircBuf_c<data_t, BuffSize>::Peek(void) {
-	//Read one value from buffer.
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+data_t CircBuf_c<data_t, BuffSize, Policy, Stats>::Peek(void) {
+	//Read one value from buffer, without consuming.
 	data_t read_data = 0;
-	if (this->Available()) {
-		read_data = this->bufPtr[this->readPtr];
+	uint32_t read = __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE);
+	
+	if (__atomic_load_n(&this->writePtr, __ATOMIC_ACQUIRE) != read) {
+		read_data = this->bufPtr[read & indexMask];
 	}
 	return read_data;
 }
 
-template <class data_t, uint32_t BuffSize>
-uint32_t CircBuf_c<data_t, BuffSize>::Available(void) 
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+uint32_t CircBuf_c<data_t, BuffSize, Policy, Stats>::Available(void) 
+{
+	// Read index first, so a concurrent push can only over-estimate; clamp that.
+	uint32_t read = __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE);
+	uint32_t count = __atomic_load_n(&this->writePtr, __ATOMIC_ACQUIRE) - read;
+	
+	return (count > BuffSize) ? BuffSize : count;
+}
+
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+uint32_t CircBuf_c<data_t, BuffSize, Policy, Stats>::Space(void) 
+{
+	return BuffSize - (this->writePtr - __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE));
+}
+
+
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+uint32_t CircBuf_c<data_t, BuffSize, Policy, Stats>::PushN(const data_t* data, uint32_t count) 
+{
+	//Add several values to buffer, handling overflow as per Policy.
+	uint32_t write = this->writePtr;
+	uint32_t space = BuffSize - (write - __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE));
+	
+	if (count > space) {
+		if (Policy == circbuf_overwriteOldest) {
+			if (count > BuffSize) { // Only the newest BuffSize elements can survive.
+				this->statsDropped(count - BuffSize);
+				data += count - BuffSize;
+				count = BuffSize;
+			}
+			// Only what is retired here was lost: the consumer may have taken some first.
+			this->statsDropped(this->retireTo(write + count - BuffSize));
+		}
+		else if (Policy == circbuf_dropNewest) {
+			this->statsDropped(count - space);
+			count = space;
+		}
+		else {
+			return 0;
+		}
+	}
+	
+	// Copy in up to two segments: to end of array, then wrapped to start.
+	uint32_t start = write & indexMask;
+	uint32_t first = (count < BuffSize - start) ? count : BuffSize - start;
+	memcpy(&this->bufPtr[start], data, first * sizeof(data_t));
+	memcpy(&this->bufPtr[0], data + first, (count - first) * sizeof(data_t));
+	
+	__atomic_store_n(&this->writePtr, write + count, __ATOMIC_RELEASE);
+	
+	this->statsLevel((count > space) ? BuffSize : BuffSize - space + count);
+	return count;
+}
+
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+uint32_t CircBuf_c<data_t, BuffSize, Policy, Stats>::PopN(data_t* data, uint32_t count) 
+{
+	//Read up to count values from buffer.
+	uint32_t read = __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE);
+	uint32_t num;
+	
+	do {
+		num = __atomic_load_n(&this->writePtr, __ATOMIC_ACQUIRE) - read;
+		if (num > BuffSize) {
+			num = BuffSize; // Stale read index, compare-exchange will fail below.
+		}
+		if (num > count) {
+			num = count;
+		}
+		
+		uint32_t start = read & indexMask;
+		uint32_t first = (num < BuffSize - start) ? num : BuffSize - start;
+		memcpy(data, &this->bufPtr[start], first * sizeof(data_t));
+		memcpy(data + first, &this->bufPtr[0], (num - first) * sizeof(data_t));
+		// If the producer overwrote any of this meanwhile, read is reloaded and we retry.
+	} while (num && !__atomic_compare_exchange_n(&this->readPtr, &read, read + num, false, 
+		__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+	
+	return num;
+}
+
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+data_t* CircBuf_c<data_t, BuffSize, Policy, Stats>::ReadRegion(uint32_t* length, uint32_t offset) 
 {
-	int64_t count = this->writePtr - this->readPtr;
-	if (count < 0) { // If write pointer has wrapped before read pointer
-		count += BuffSize;
+	//Contiguous filled area from read index (plus offset), up to end of array.
+	uint32_t read = __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE);
+	uint32_t count = __atomic_load_n(&this->writePtr, __ATOMIC_ACQUIRE) - read;
+	uint32_t start = (read + offset) & indexMask;
+	
+	if (count > BuffSize) {
+		count = BuffSize;
 	}
-	return (uint32_t)count;
+	count = (count > offset) ? count - offset : 0;
+	*length = (count < BuffSize - start) ? count : BuffSize - start;
+	return &this->bufPtr[start];
+}
+
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+bool CircBuf_c<data_t, BuffSize, Policy, Stats>::Find(data_t value, uint32_t* position, uint32_t offset) 
+{
+	//Search in up to two segments, like PopN, but leave the read index alone.
+	uint32_t read = __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE);
+	uint32_t count = __atomic_load_n(&this->writePtr, __ATOMIC_ACQUIRE) - read;
 	
-	//return this->count;
+	if (count > BuffSize) {
+		count = BuffSize;
+	}
+	while (offset < count) {
+		uint32_t start = (read + offset) & indexMask;
+		uint32_t run = (count - offset < BuffSize - start) ? count - offset : BuffSize - start;
+		const data_t* segment = &this->bufPtr[start];
+		
+		if (sizeof(data_t) == 1) {
+			const data_t* match = (const data_t*)memchr(segment, value, run); // Byte buffers: library search.
+			if (match) {
+				*position = offset + (match - segment);
+				return true;
+			}
+		}
+		else {
+			for (uint32_t i = 0; i < run; i++) {
+				if (segment[i] == value) {
+					*position = offset + i;
+					return true;
+				}
+			}
+		}
+		offset += run;
+	}
+	*position = offset;
+	return false;
+}
+
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+void CircBuf_c<data_t, BuffSize, Policy, Stats>::CommitRead(uint32_t count) 
+{
+	//Consume elements handed out by ReadRegion.
+	this->retireTo(__atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE) + count);
+}
+
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+uint32_t CircBuf_c<data_t, BuffSize, Policy, Stats>::ReadIndex(void) 
+{
+	return __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE);
+}
+
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+void CircBuf_c<data_t, BuffSize, Policy, Stats>::CommitReadTo(uint32_t index) 
+{
+	//Consume up to an index from ReadIndex(), unless already past it.
+	this->retireTo(index);
+}
+
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+data_t* CircBuf_c<data_t, BuffSize, Policy, Stats>::WriteRegion(uint32_t* length, uint32_t offset) 
+{
+	//Contiguous free area from write index (plus offset), up to end of array.
+	uint32_t write = this->writePtr;
+	uint32_t space = BuffSize - (write - __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE));
+	uint32_t start = (write + offset) & indexMask;
+	
+	space = (space > offset) ? space - offset : 0;	
+	*length = (space < BuffSize - start) ? space : BuffSize - start;
+	return &this->bufPtr[start];
+}
+
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+void CircBuf_c<data_t, BuffSize, Policy, Stats>::CommitWrite(uint32_t count) 
+{
+	//Publish elements filled in through WriteRegion.
+	uint32_t write = this->writePtr + count;
+	__atomic_store_n(&this->writePtr, write, __ATOMIC_RELEASE);
+	
+	this->statsLevel(write - __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE));
+}
+
+
+template <class data_t, uint32_t BuffSize, uint32_t Policy, bool Stats>
+uint32_t CircBuf_c<data_t, BuffSize, Policy, Stats>::retireTo(uint32_t newRead) 
+{
+	uint32_t read = __atomic_load_n(&this->readPtr, __ATOMIC_ACQUIRE);
+	
+	// Signed difference copes with index wrap-around.
+	while ((int32_t)(newRead - read) > 0) {
+		if (__atomic_compare_exchange_n(&this->readPtr, &read, newRead, false, 
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			return newRead - read; // From the index the exchange replaced.
+		}
+	}
+	return 0;
 }
@@ -1,8 +1,13 @@
 /*
  * CircBuf.hpp
- * FIFO Circular Buffer with overwrite-oldest-on-full.
+ * FIFO Circular Buffer with selectable behaviour when full 
+ * (overwrite-oldest by default).
  * Based on an implementation by GitHub's yagihiro.
  *
+ * Safe for one producer and one consumer running in different contexts
+ * (e.g. an interrupt handler pushing and the main loop popping) without 
+ * disabling interrupts. BuffSize must be a power of two.
+ *
  * Created: 14/05/2016
  * Modified: 04/11/2016
  * Author: Ben Jones
@@ -11,30 +16,111 @@
 #ifndef CIRCBUFF_HPP_
 #define CIRCBUFF_HPP_
 
+#include <string.h> // memcpy
+
 //#define CIRCBUFF_DEFAULT_SIZE 256
 
-template <class data_t, uint32_t BuffSize> 
-class CircBuf_c {
+//Overflow policies, for the Policy template argument:
+//	overwriteOldest: Push always succeeds, oldest element is lost.
+//	dropNewest: Push discards the new element, and counts it as dropped.
+//	reject: Push returns false and the caller keeps the element.
+enum {circbuf_overwriteOldest, circbuf_dropNewest, circbuf_reject};
+
+
+//Optional dropped-element and high-water-mark counters. With Stats = false 
+// these are empty and take no storage, and the getters return 0.
+template <bool Enabled>
+class CircBufStats_c {
+	public:
+		uint32_t DroppedCount(void) { return this->dropped; }
+		uint32_t HighWaterMark(void) { return this->highWater; }
+	
+	protected:
+		CircBufStats_c() : dropped(0), highWater(0) {}
+		void statsDropped(uint32_t count) { this->dropped += count; }
+		void statsLevel(uint32_t level) { if (level > this->highWater) this->highWater = level; }
+	
+	private:
+		uint32_t dropped;
+		uint32_t highWater;
+};
+
+template <>
+class CircBufStats_c<false> {
+	public:
+		uint32_t DroppedCount(void) { return 0; }
+		uint32_t HighWaterMark(void) { return 0; }
+	
+	protected:
+		void statsDropped(uint32_t) {}
+		void statsLevel(uint32_t) {}
+};
+
+
+//Policy is fixed at compile time, so unused policies cost nothing on the hot path.
+template <class data_t, uint32_t BuffSize, uint32_t Policy = circbuf_overwriteOldest, bool Stats = false> 
+class CircBuf_c : public CircBufStats_c<Stats> {
+	static_assert(BuffSize != 0 && (BuffSize & (BuffSize - 1)) == 0, 
+		"CircBuf_c: BuffSize must be a power of two");
+	static_assert(Policy <= circbuf_reject, "CircBuf_c: unknown overflow policy");
+	
 	public:
 		//Initialiser:
 		CircBuf_c();
 	
-		//Write:
-		void Push(data_t data);
+		//Write (producer side only). Returns false if data was not stored.
+		bool Push(data_t data);
 	
-		//Read:
+		//Read (consumer side only):
 		data_t Pop(void);
 		data_t Peek(void);
 	
+		//Bulk copies in at most two segments. Return number of elements copied.
+		// With circbuf_reject, PushN stores all of data or none of it.
+		uint32_t PushN(const data_t* data, uint32_t count);
+		uint32_t PopN(data_t* data, uint32_t count);
+		
+		//In-place access for DMA or parsers: returns start of the contiguous 
+		// filled (read) or free (write) area and its length, then commit 
+		// however many elements were actually used. With circbuf_overwriteOldest 
+		// the read region can still be overwritten by an overflowing producer.
+		// Offset skips elements, e.g. to reach the wrapped part of the area.
+		data_t* ReadRegion(uint32_t* length, uint32_t offset = 0);
+		void CommitRead(uint32_t count);
+		
+		//Free-running read index, for holding data in place across calls: if it 
+		// has moved on, an overwriting producer (or another read) retired data 
+		// from under the holder. CommitReadTo consumes up to an index from here, 
+		// so a count can't run on from a moved index; it never moves backwards.
+		uint32_t ReadIndex(void);
+		void CommitReadTo(uint32_t index);
+		data_t* WriteRegion(uint32_t* length, uint32_t offset = 0);
+		void CommitWrite(uint32_t count);
+	
+		//Searches the filled area from offset onwards without consuming anything. 
+		// Returns true with the match's position from the read index, or false 
+		// with position set to how far the search got (so it can resume there).
+		bool Find(data_t value, uint32_t* position, uint32_t offset = 0);
+	
 		//Bytes available:
 		uint32_t Available(void);
+		//Free space, as seen by the producer:
+		uint32_t Space(void);
 	
 	private:
+		static const uint32_t indexMask = BuffSize - 1;
+		
+		//Advance readPtr to at least newRead, unless the other side already has. 
+		// Returns how many elements this call retired.
+		uint32_t retireTo(uint32_t newRead);
+		
 		data_t bufPtr[BuffSize];
+		
+		//Free-running indices, masked on access. The producer owns writePtr, 
+		// the consumer owns readPtr - except when an overwriting producer discards 
+		// the oldest element on overflow, which is arbitrated by compare-exchange.
 		uint32_t readPtr;
 		uint32_t writePtr;
-		
-		//uint32_t count;
 };
 
 #include "CircBuf.cpp"
@@ -0,0 +1,287 @@
+/*
+ * samModbus.cpp
+ * Modbus RTU slave, running entirely from the USART interrupt.
+ *
+ * Created: 17/10/2026
+ */
+
+#include "sam.h"
+#include "string.h"
+
+
+//Modbus CRC16 (reflected polynomial 0xA001), one table lookup per byte.
+static const uint16_t modbusCRCTable[256] = {
+	0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+	0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+	0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+	0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+	0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+	0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+	0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+	0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+	0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+	0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+	0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+	0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+	0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+	0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+	0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+	0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+	0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+	0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+	0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+	0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+	0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+	0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+	0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+	0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+	0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+	0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+	0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+	0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+	0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+	0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+	0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+	0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+
+uint16_t modbusSlave_c::CRC16(const uint8_t* data, uint32_t length) {
+	uint16_t crc = 0xFFFF;
+	
+	while (length--) {
+		crc = (crc >> 8) ^ modbusCRCTable[(crc ^ *(data++)) & 0xFF];
+	}
+	return crc;
+}
+
+
+//Initialiser: RS-485 mode, with frames delimited by the 3.5 character gap.
+bool modbusSlave_c::Begin(samUSART_c* port, uint8_t address, uint32_t baud, uint32_t parity, 
+	const modbusCallbacks_t* callbacks) 
+{
+	this->callbacks = callbacks;
+	this->address = address;
+	this->requests = 0;
+	this->crcErrors = 0;
+	
+	//Modbus characters are always 11 bits. Above 19200 baud the gap is fixed at 1.75ms.
+	uint32_t gapBits = 39;
+	if (baud > 19200) {
+		gapBits = (baud * 7 + 3999) / 4000;
+	}
+	
+	if (!port->Begin(usart_modeSerialAsync, baud, parity, usart_optionAsyncRS485)) {
+		return false;
+	}
+	port->FrameModeEnable(modbusSlave_c::frameHandler, this, gapBits);
+	return true;
+}
+
+uint32_t modbusSlave_c::RequestCount(void) {
+	return this->requests;
+}
+
+uint32_t modbusSlave_c::CRCErrorCount(void) {
+	return this->crcErrors;
+}
+
+
+uint32_t modbusSlave_c::frameHandler(void* context, uint8_t* frame, uint32_t length, uint32_t maxLength) {
+	//Largest reply (125 registers or 2000 coils) is 255 bytes.
+	if (maxLength < 256) {
+		return 0;
+	}
+	return ((modbusSlave_c*)context)->process(frame, length);
+}
+
+uint32_t modbusSlave_c::process(uint8_t* frame, uint32_t length) {
+	//Check frame is whole, and for us:
+	if (length < 4) {
+		return 0;
+	}
+	if (modbusSlave_c::CRC16(frame, length) != 0) {
+		this->crcErrors++;
+		return 0;
+	}
+	if (frame[0] != this->address && frame[0] != 0) {
+		return 0;
+	}
+	this->requests++;
+	length -= 2; // Drop CRC.
+	
+	//Execute, building the reply over the request:
+	uint32_t reply = 0;
+	uint8_t error;
+	switch (frame[1]) {
+		case 0x01:
+		case 0x02:
+			error = this->readBits(frame, length, &reply);
+			break;
+		case 0x03:
+		case 0x04:
+			error = this->readRegisters(frame, length, &reply);
+			break;
+		case 0x05:
+		case 0x06:
+			error = this->writeSingle(frame, length, &reply);
+			break;
+		case 0x0F:
+		case 0x10:
+			error = this->writeMultiple(frame, length, &reply);
+			break;
+		default:
+			error = modbus_exceptionIllegalFunction;
+			break;
+	}
+	
+	if (frame[0] == 0) {
+		return 0; // Broadcasts are never answered.
+	}
+	if (error) {
+		frame[1] |= 0x80;
+		frame[2] = error;
+		reply = 3;
+	}
+	
+	uint16_t crc = modbusSlave_c::CRC16(frame, reply);
+	frame[reply] = crc & 0xFF; // CRC is sent low byte first.
+	frame[reply + 1] = crc >> 8;
+	return reply + 2;
+}
+
+
+//Functions 01 and 02: reply is byte count, then bits packed LSB first.
+uint8_t modbusSlave_c::readBits(uint8_t* frame, uint32_t length, uint32_t* reply) {
+	uint8_t (*read)(uint16_t, bool*) = (frame[1] == 0x01) ? this->callbacks->coilRead : this->callbacks->discreteRead;
+	
+	if (read == NULL) {
+		return modbus_exceptionIllegalFunction;
+	}
+	if (length != 6) {
+		return modbus_exceptionIllegalValue;
+	}
+	uint32_t start = (frame[2] << 8) | frame[3];
+	uint32_t count = (frame[4] << 8) | frame[5];
+	if (count < 1 || count > 2000) {
+		return modbus_exceptionIllegalValue;
+	}
+	if (start + count > 0x10000) {
+		return modbus_exceptionIllegalAddress;
+	}
+	
+	frame[2] = (count + 7) / 8;
+	memset(&frame[3], 0, frame[2]);
+	for (uint32_t i = 0; i < count; i++) {
+		bool value = false;
+		uint8_t error = read(start + i, &value);
+		if (error) {
+			return error;
+		}
+		frame[3 + i / 8] |= value << (i & 7);
+	}
+	*reply = 3 + frame[2];
+	return modbus_exceptionNone;
+}
+
+//Functions 03 and 04: reply is byte count, then big-endian registers.
+uint8_t modbusSlave_c::readRegisters(uint8_t* frame, uint32_t length, uint32_t* reply) {
+	uint8_t (*read)(uint16_t, uint16_t*) = (frame[1] == 0x03) ? this->callbacks->holdingRead : this->callbacks->inputRead;
+	
+	if (read == NULL) {
+		return modbus_exceptionIllegalFunction;
+	}
+	if (length != 6) {
+		return modbus_exceptionIllegalValue;
+	}
+	uint32_t start = (frame[2] << 8) | frame[3];
+	uint32_t count = (frame[4] << 8) | frame[5];
+	if (count < 1 || count > 125) {
+		return modbus_exceptionIllegalValue;
+	}
+	if (start + count > 0x10000) {
+		return modbus_exceptionIllegalAddress;
+	}
+	
+	frame[2] = count * 2;
+	for (uint32_t i = 0; i < count; i++) {
+		uint16_t value = 0;
+		uint8_t error = read(start + i, &value);
+		if (error) {
+			return error;
+		}
+		frame[3 + 2 * i] = value >> 8;
+		frame[4 + 2 * i] = value & 0xFF;
+	}
+	*reply = 3 + frame[2];
+	return modbus_exceptionNone;
+}
+
+//Functions 05 and 06: reply echoes the request.
+uint8_t modbusSlave_c::writeSingle(uint8_t* frame, uint32_t length, uint32_t* reply) {
+	uint8_t error;
+	
+	if (length != 6) {
+		return modbus_exceptionIllegalValue;
+	}
+	uint16_t address = (frame[2] << 8) | frame[3];
+	uint16_t value = (frame[4] << 8) | frame[5];
+	
+	if (frame[1] == 0x05) {
+		if (this->callbacks->coilWrite == NULL) {
+			return modbus_exceptionIllegalFunction;
+		}
+		if (value != 0xFF00 && value != 0x0000) {
+			return modbus_exceptionIllegalValue;
+		}
+		error = this->callbacks->coilWrite(address, value != 0);
+	}
+	else {
+		if (this->callbacks->holdingWrite == NULL) {
+			return modbus_exceptionIllegalFunction;
+		}
+		error = this->callbacks->holdingWrite(address, value);
+	}
+	
+	*reply = 6;
+	return error;
+}
+
+//Functions 15 and 16: reply is the start address and count.
+uint8_t modbusSlave_c::writeMultiple(uint8_t* frame, uint32_t length, uint32_t* reply) {
+	uint8_t error = modbus_exceptionNone;
+	
+	if (length < 7 || length != 7 + (uint32_t)frame[6]) {
+		return modbus_exceptionIllegalValue;
+	}
+	uint32_t start = (frame[2] << 8) | frame[3];
+	uint32_t count = (frame[4] << 8) | frame[5];
+	if (start + count > 0x10000) {
+		return modbus_exceptionIllegalAddress;
+	}
+	
+	if (frame[1] == 0x0F) {
+		if (this->callbacks->coilWrite == NULL) {
+			return modbus_exceptionIllegalFunction;
+		}
+		if (count < 1 || count > 1968 || frame[6] != (count + 7) / 8) {
+			return modbus_exceptionIllegalValue;
+		}
+		for (uint32_t i = 0; i < count && !error; i++) {
+			error = this->callbacks->coilWrite(start + i, (frame[7 + i / 8] >> (i & 7)) & 1);
+		}
+	}
+	else {
+		if (this->callbacks->holdingWrite == NULL) {
+			return modbus_exceptionIllegalFunction;
+		}
+		if (count < 1 || count > 123 || frame[6] != count * 2) {
+			return modbus_exceptionIllegalValue;
+		}
+		for (uint32_t i = 0; i < count && !error; i++) {
+			error = this->callbacks->holdingWrite(start + i, (frame[7 + 2 * i] << 8) | frame[8 + 2 * i]);
+		}
+	}
+	
+	*reply = 6;
+	return error;
+}
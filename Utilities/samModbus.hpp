@@ -0,0 +1,79 @@
+/*
+ * samModbus.hpp
+ * Modbus RTU slave, running entirely from the USART interrupt.
+ *
+ * The USART is put in RS-485 mode (RTS enables the line driver) and frame 
+ * mode, so each request arrives whole after the 3.5 character gap, is checked 
+ * and dispatched to the register/coil callbacks, and the reply is sent by the 
+ * PDC - no main loop involvement. The callbacks therefore run in interrupt 
+ * context and should be quick.
+ *
+ * Supported functions: 01/02 read coils/discrete inputs, 03/04 read holding/input 
+ * registers, 05/15 write coil(s), 06/16 write holding register(s).
+ *
+ * Created: 17/10/2026
+ */
+
+
+#ifndef SAMMODBUS_HPP_
+#define SAMMODBUS_HPP_
+
+#include "sam.h"
+#include "../Drivers/samUSART.hpp"
+
+
+//Exception codes, returned by callbacks (0 for success) and sent to the master.
+enum {modbus_exceptionNone = 0x00, modbus_exceptionIllegalFunction = 0x01, 
+	modbus_exceptionIllegalAddress = 0x02, modbus_exceptionIllegalValue = 0x03, 
+	modbus_exceptionDeviceFailure = 0x04};
+
+//Data model callbacks, one item at a time. NULL entries answer "illegal function".
+struct modbusCallbacks_t {
+	uint8_t (*coilRead)(uint16_t address, bool* value);			// Function 01
+	uint8_t (*discreteRead)(uint16_t address, bool* value);		// Function 02
+	uint8_t (*holdingRead)(uint16_t address, uint16_t* value);	// Function 03
+	uint8_t (*inputRead)(uint16_t address, uint16_t* value);		// Function 04
+	uint8_t (*coilWrite)(uint16_t address, bool value);			// Functions 05 and 15
+	uint8_t (*holdingWrite)(uint16_t address, uint16_t value);	// Functions 06 and 16
+};
+
+
+class modbusSlave_c {
+	public:
+		//Initialiser: sets up the USART and starts answering requests to address 
+		// (1-247, plus broadcasts to 0). GPIO pins (including RTS for the driver 
+		// enable) still need to be set to the USART peripheral function. Returns 
+		// false if the baud rate can't be made from the current clock.
+		bool Begin(samUSART_c* port, uint8_t address, uint32_t baud, uint32_t parity, 
+			const modbusCallbacks_t* callbacks);
+		
+		//Frames handled, and frames dropped for a bad CRC.
+		uint32_t RequestCount(void);
+		uint32_t CRCErrorCount(void);
+		
+		//Modbus CRC16 (table driven). Over a whole frame including its CRC, gives 0.
+		static uint16_t CRC16(const uint8_t* data, uint32_t length);
+	
+	private:
+		//Frame mode handler: context is the modbusSlave_c.
+		static uint32_t frameHandler(void* context, uint8_t* frame, uint32_t length, uint32_t maxLength);
+		
+		//Executes one request in place, returns reply length (0 for none).
+		uint32_t process(uint8_t* frame, uint32_t length);
+		
+		//Function groups. Return an exception code, and the reply length without CRC.
+		uint8_t readBits(uint8_t* frame, uint32_t length, uint32_t* reply);
+		uint8_t readRegisters(uint8_t* frame, uint32_t length, uint32_t* reply);
+		uint8_t writeSingle(uint8_t* frame, uint32_t length, uint32_t* reply);
+		uint8_t writeMultiple(uint8_t* frame, uint32_t length, uint32_t* reply);
+		
+		//State variables:
+		const modbusCallbacks_t* callbacks;
+		uint8_t address;
+		volatile uint32_t requests;
+		volatile uint32_t crcErrors;
+};
+
+#include "samModbus.cpp"
+
+#endif /* SAMMODBUS_HPP_ */
@@ -13,6 +13,111 @@
  */
 
 #include "stdarg.h"
+#include "string.h"
+
+
+uint32_t SerialStream::WriteBlock(const uint8_t* data, uint32_t num_bytes) {
+	//Default: one byte at a time.
+	for (uint32_t i = 0; i < num_bytes; i++) {
+		this->Write(data[i]);
+	}
+	return num_bytes;
+}
+
+uint32_t SerialStream::ReadBlock(uint8_t* data, uint32_t num_bytes) {
+	//Default: one byte at a time, stopping when empty.
+	uint32_t i;
+	
+	for (i = 0; i < num_bytes && this->Available() > 0; i++) {
+		data[i] = this->Read();
+	}
+	return i;
+}
+
+uint32_t SerialStream::WriteSpace(void) {
+	//Default: no buffer to run out of, so never hold the writer back.
+	return 0xFFFFFFFF;
+}
+
+
+template <class buffer_t>
+bool serialLineGet(buffer_t* buffer, serialLineState_t* state, serialLine_t* line) 
+{
+	uint32_t position;
+	
+	while (true) {
+		//Positions count from the read index. If that has moved since the last 
+		// call - an overflowing producer retired bytes from under a partial line - 
+		// the search starts again from the new one.
+		uint32_t read = buffer->ReadIndex();
+		if (read != state->start) {
+			state->start = read;
+			state->scanned = 0;
+		}
+		
+		//Only search bytes that arrived since the last call.
+		bool found = buffer->Find(state->delimiter, &position, state->scanned);
+		if (buffer->ReadIndex() != read) {
+			continue; // Overwritten while searching.
+		}
+		
+		if (state->discarding) {
+			//Drop everything up to and including the overlong line's delimiter.
+			buffer->CommitReadTo(read + (found ? position + 1 : position));
+			if (!found) {
+				return false;
+			}
+			state->discarding = false;
+			state->discarded++;
+			continue;
+		}
+		
+		if (found && position <= state->maxLength) {
+			//Complete line: hand it out in place, as one or two spans.
+			uint32_t first;
+			line->span[0] = buffer->ReadRegion(&first);
+			line->spanLength[0] = (first < position) ? first : position;
+			line->span[1] = buffer->ReadRegion(&first, line->spanLength[0]);
+			line->spanLength[1] = position - line->spanLength[0];
+			line->length = position;
+			if (buffer->ReadIndex() == read) {
+				break;
+			}
+			continue; // Overwritten meanwhile: the spans may not match.
+		}
+		if (!found && position <= state->maxLength) {
+			state->scanned = position;
+			return false; // Rest of the line still to come.
+		}
+		
+		//Too long: drop it and resynchronise on the next delimiter.
+		buffer->CommitReadTo(read + (found ? position + 1 : position));
+		if (found) {
+			state->discarded++;
+		}
+		else {
+			state->discarding = true;
+		}
+	}
+	
+	state->held = position + 1;
+	return true;
+}
+
+template <class buffer_t>
+bool serialLineRelease(buffer_t* buffer, serialLineState_t* state) 
+{
+	//Released by index, so overwritten bytes don't make this eat into the next line.
+	bool intact = !state->held || buffer->ReadIndex() == state->start;
+	if (!intact) {
+		state->overrun++;
+	}
+	buffer->CommitReadTo(state->start + state->held);
+	state->start = buffer->ReadIndex();
+	state->held = 0;
+	state->scanned = 0;
+	return intact;
+}
 
 
 uint32_t SerialStream::ReadStr(char buffer[]) {
@@ -34,31 +139,17 @@ uint32_t SerialStream::ReadStr(char buffer[]) {
 
 uint32_t SerialStream::ReadStr(char buffer[], uint32_t num_bytes) {
 	//Reads a whole string from internal receive buffer.
-	uint32_t i;
-	
-	for (i = 0; i < num_bytes && this->Available() > 0; i++) {
-		buffer[i] = this->Read();
-	}
-	return i;
+	return this->ReadBlock((uint8_t*)buffer, num_bytes);
 }
 
 void SerialStream::WriteStr(char buffer[]) {
 	//Writes a whole string to internal buffer, to be sent.
-	uint32_t i = 0;;
-	
-	while (buffer[i] != 0) {
-		this->Write(buffer[i++]);
-	}
-	
+	this->WriteBlock((uint8_t*)buffer, strlen(buffer));
 }
 
 void SerialStream::WriteStr(char buffer[], uint32_t num_bytes) {
 	//Writes a whole string to internal buffer, to be sent.
-	uint32_t i;
-	
-	for (i = 0; i < num_bytes; i++) {
-		this->Write(buffer[i]);
-	}
+	this->WriteBlock((uint8_t*)buffer, num_bytes);
 }
 
 
@@ -98,63 +189,161 @@ void SerialStream::PrintBits(uint32_t value) {
 */
 
 
-void SerialStream::PrintNum(int64_t value, bool signedValue, uint32_t base, uint32_t whitespace_pad)
+#define SERIAL_NUM_BUFF_LENGTH 72 // Longest number is 64 binary digits, plus sign and padding.
+
+//Decimal digits in pairs, "00" to "99", so each division by 100 gives two digits.
+static const char serialDigitPairs[] = 
+	"0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+	"5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+//Decimal conversion of up to 32 bits, backwards from ptr. 32-bit division by a 
+// constant compiles to a multiply, unlike 64-bit division which is a library call.
+static char* serialDecimal32(char* ptr, uint32_t value) 
 {
-	//Prints a number out in human-readable form. 
-	
-#define buff_len 50         // Note max uint64_t value is 20 digits long, plus whitespace.
-	char buff[buff_len]; 
-	char *ptr = buff + buff_len - 1; // Will be writing to end of buffer.
-	
-	if ((value < 0) && signedValue) 
-	{
-		this->Write('-');
-		value = -value;
+	while (value >= 100) {
+		uint32_t pair = (value % 100) * 2;
+		value /= 100;
+		*(--ptr) = serialDigitPairs[pair + 1];
+		*(--ptr) = serialDigitPairs[pair];
 	}
-	
-	*ptr = '\0'; // Null terminator
+	if (value >= 10) {
+		*(--ptr) = serialDigitPairs[value * 2 + 1];
+		*(--ptr) = serialDigitPairs[value * 2];
+	}
+	else {
+		*(--ptr) = '0' + value;
+	}
+	return ptr;
+}
+
+char* SerialStream::numToAscii(char* end, int64_t value, bool signedValue, uint32_t base, uint32_t whitespace_pad)
+{
+	//Converts a number to human-readable form, from the last digit back.
+	char* ptr = end;
+	bool negative = signedValue && (value < 0);
+	uint64_t magnitude = negative ? 0 - (uint64_t)value : (uint64_t)value; // Also right for INT64_MIN.
 	
 	// Convert to ascii:
-	do {
-		//*(--ptr) = '0' + (value % base);
-		*(--ptr) = SerialAsciiTable[value % base];
-		value /= base;
-	} while ((value > 0 && ptr > buff));
+	if (base == 10) {
+		//Above 32 bits, split off nine digits at a time: one 64-bit division each, not one per digit.
+		while (magnitude > 0xFFFFFFFFULL) {
+			uint32_t chunk = magnitude % 1000000000;
+			char* chunkEnd = ptr;
+			magnitude /= 1000000000;
+			ptr = serialDecimal32(ptr, chunk);
+			while (chunkEnd - ptr < 9) {
+				*(--ptr) = '0';
+			}
+		}
+		ptr = serialDecimal32(ptr, (uint32_t)magnitude);
+	}
+	else if ((base & (base - 1)) == 0) { 
+		//Binary, octal, hex: shift and mask, on 32 bits once the top half is used up.
+		uint32_t shift = __builtin_ctz(base);
+		uint32_t mask = base - 1;
+		while (magnitude > 0xFFFFFFFFULL) {
+			*(--ptr) = SerialAsciiTable[magnitude & mask];
+			magnitude >>= shift;
+		}
+		uint32_t low = magnitude;
+		do {
+			*(--ptr) = SerialAsciiTable[low & mask];
+			low >>= shift;
+		} while (low > 0);
+	}
+	else if (magnitude <= 0xFFFFFFFFULL) {
+		uint32_t low = magnitude;
+		do {
+			*(--ptr) = SerialAsciiTable[low % base];
+			low /= base;
+		} while (low > 0);
+	}
+	else {
+		do {
+			*(--ptr) = SerialAsciiTable[magnitude % base];
+			magnitude /= base;
+		} while (magnitude > 0);
+	}
+	
+	if (negative) {
+		*(--ptr) = '-';
+	}
 	
 	//Whitespace pad, if needed:
-	// while used_characters < whitespace_width
-	while ((buff - ptr + buff_len) < whitespace_pad && ptr > buff)
-	{
+	if (whitespace_pad > SERIAL_NUM_BUFF_LENGTH) {
+		whitespace_pad = SERIAL_NUM_BUFF_LENGTH;
+	}
+	while ((uint32_t)(end - ptr) < whitespace_pad) {
 		*(--ptr) = ' ';
 	}
 	
-	// Write out buffer:
-	this->WriteStr(ptr);
-	//this->WriteStr(ptr, -1);
+	return ptr;
 }
 
+void SerialStream::PrintNum(int64_t value, bool signedValue, uint32_t base, uint32_t whitespace_pad)
+{
+	//Prints a number out in human-readable form, as one block.
+	char buff[SERIAL_NUM_BUFF_LENGTH];
+	char* start = SerialStream::numToAscii(buff + SERIAL_NUM_BUFF_LENGTH, value, signedValue, base, whitespace_pad);
+	
+	this->WriteBlock((const uint8_t*)start, buff + SERIAL_NUM_BUFF_LENGTH - start);
+}
 
 
-void SerialStream::printf(const char* format, ...) 
+void SerialStream::formatBlock(serialFormatOut_t* out, const char* text, uint32_t length)
+{
+	//Copies into the output buffer, sending it on (or truncating) whenever it fills.
+	out->total += length;
+	
+	while (length) {
+		uint32_t room = out->size - out->used;
+		if (room == 0) {
+			if (out->stream == NULL) {
+				return; // snprintf: truncate.
+			}
+			out->stream->WriteBlock((const uint8_t*)out->buffer, out->used);
+			out->used = 0;
+			room = out->size;
+		}
+		
+		//Fields are short, so a plain loop beats a memcpy call here.
+		uint32_t chunk = (length < room) ? length : room;
+		char* dest = out->buffer + out->used;
+		out->used += chunk;
+		length -= chunk;
+		while (chunk--) {
+			*(dest++) = *(text++);
+		}
+	}
+}
+
+void SerialStream::formatV(serialFormatOut_t* out, const char* format, va_list arg) 
 {
 	// Basic implementation of formatted text printing. 
+	char number[SERIAL_NUM_BUFF_LENGTH];
+	char* numberEnd = number + SERIAL_NUM_BUFF_LENGTH;
+	char* start;
 	char cc;
 	
-	//Handle argument list:
-	va_list arg;
-	va_start(arg, format);
-	
 	//Iterate through format string:
 	while ((cc = *(format++))) 
 	{
 		if (cc != '%') 
 		{
-			this->Write(cc); // Pass through normal text
+			// Pass through normal text, up to the next specifier, in one block.
+			const char* text = format - 1;
+			while (*format && *format != '%') {
+				format++;
+			}
+			SerialStream::formatBlock(out, text, format - text);
 		}
 		
 		else 
 		{
+			uint32_t precision;
+			format = SerialStream::specParse(format, &precision);
 			cc = *(format++); // cc will now be the data type to print
+			start = numberEnd;
 			
 			switch (cc) {
 				default:
@@ -164,38 +353,441 @@ void SerialStream::printf(const char* format, ...)
 					break;
 					
 				case '%': // Print percent.
-					this->Write('%');
+					*(--start) = '%';
 					break;
 				
 				case 'c': // Character
-					this->Write((char)va_arg(arg, unsigned int));
+					*(--start) = (char)va_arg(arg, unsigned int);
 					break;
 				
-				case 's': // String
-					this->WriteStr((char*)va_arg(arg, char*));
+				case 's': { // String
+					const char* text = va_arg(arg, const char*);
+					SerialStream::formatBlock(out, text, strlen(text));
 					break;
+				}
 					
 				case 'd': // Decimal
-				case 'u': // Unsigned
 				case 'i': // Integer
-					this->PrintNum(va_arg(arg, int), true, 10, 0);
+					start = SerialStream::numToAscii(numberEnd, va_arg(arg, int), true, 10, 0);
+					break;
+				case 'u': // Unsigned
+					start = SerialStream::numToAscii(numberEnd, va_arg(arg, unsigned int), false, 10, 0);
 					break;
 				case 'b': // Binary/bitfield
-					this->PrintNum(va_arg(arg, unsigned int), false, 2, 32);
+					start = SerialStream::numToAscii(numberEnd, va_arg(arg, unsigned int), false, 2, 32);
 					break;
 				case 'x': // Hex
-					this->WriteStr("0x");
-					this->PrintNum(va_arg(arg, unsigned int), false, 16, 0);
+					start = SerialStream::numToAscii(numberEnd, va_arg(arg, unsigned int), false, 16, 0);
+					*(--start) = 'x';
+					*(--start) = '0';
 					break;
 				case 'o': // Octal
-					this->Write('0');
-					this->PrintNum(va_arg(arg, unsigned int), false, 8, 0);
+					start = SerialStream::numToAscii(numberEnd, va_arg(arg, unsigned int), false, 8, 0);
+					*(--start) = '0';
+					break;
+					
+				case 'f': // Fixed and exponent notation (floats are passed as double)
+				case 'e':
+					SerialStream::formatDouble(out, cc, precision, va_arg(arg, double));
+					break;
+				case 'q': // Q15 and Q31 fixed point
+					SerialStream::printInteger(out, cc, precision, (int16_t)va_arg(arg, int), true);
+					break;
+				case 'Q':
+					SerialStream::printInteger(out, cc, precision, (int32_t)va_arg(arg, int), true);
 					break;
 			}
+			
+			SerialStream::formatBlock(out, start, numberEnd - start);
+		}
+	}
+}
+
+
+//Optional .N precision, after the '%'. Returns the specifier letter.
+const char* SerialStream::specParse(const char* format, uint32_t* precision) 
+{
+	*precision = SERIAL_PRECISION_DEFAULT;
+	if (*format == '.') {
+		*precision = 0;
+		while (*(++format) >= '0' && *format <= '9') {
+			*precision = *precision * 10 + (*format - '0');
+		}
+	}
+	if (*precision > 9) {
+		*precision = 9; // Limit of the 32-bit fraction.
+	}
+	return format;
+}
+
+
+//Powers of ten for rounding and splitting fractions, up to 9 decimal places:
+static const uint32_t serialPow10[10] = {1, 10, 100, 1000, 10000, 100000, 1000000, 
+	10000000, 100000000, 1000000000};
+
+void SerialStream::formatFixed(serialFormatOut_t* out, bool negative, uint64_t mantissa, int32_t exponent, uint32_t precision) 
+{
+	//Split into whole part, and fraction as 32-bit binary fixed point (enough for 9 digits):
+	uint64_t whole = 0;
+	uint32_t fraction = 0;
+	
+	if (exponent >= 0) {
+		whole = mantissa << exponent; // Caller makes sure this fits.
+	}
+	else {
+		uint32_t shift = -exponent;
+		if (shift < 64) {
+			whole = mantissa >> shift;
+		}
+		if (shift <= 32) {
+			fraction = (uint32_t)(mantissa << (32 - shift));
 		}
+		else if (shift - 32 < 64) {
+			fraction = (uint32_t)(mantissa >> (shift - 32));
+		}
+	}
+	
+	//Round to precision digits, carrying into the whole part:
+	uint32_t scale = serialPow10[precision];
+	uint32_t digits = ((uint64_t)fraction * scale + 0x80000000UL) >> 32;
+	if (digits >= scale) {
+		digits -= scale;
+		whole++;
 	}
 	
+	//Whole part, then fraction with leading zeros:
+	char number[SERIAL_NUM_BUFF_LENGTH];
+	char* numberEnd = number + SERIAL_NUM_BUFF_LENGTH;
+	char* start = numberEnd;
+	
+	if (precision) {
+		start = SerialStream::numToAscii(numberEnd, digits, false, 10, precision);
+		for (char* pad = start; *pad == ' '; pad++) {
+			*pad = '0';
+		}
+		*(--start) = '.';
+	}
+	start = SerialStream::numToAscii(start, whole, false, 10, 0);
+	if (negative) {
+		*(--start) = '-';
+	}
+	SerialStream::formatBlock(out, start, numberEnd - start);
+}
+
+//Single precision from mantissa * 2^exponent, by building the float's bits. 
+// Truncates, and flushes tiny values to zero.
+static float serialToFloat(uint64_t mantissa, int32_t exponent) 
+{
+	if (mantissa == 0) {
+		return 0.0f;
+	}
+	int32_t bits = 64 - __builtin_clzll(mantissa);
+	if (bits > 24) {
+		mantissa >>= bits - 24;
+		exponent += bits - 24;
+	}
+	else {
+		mantissa <<= 24 - bits;
+		exponent -= 24 - bits;
+	}
+	
+	int32_t biased = exponent + 150; // Float exponent field, for a 24-bit mantissa.
+	uint32_t word = (biased >= 255) ? 0x7F800000UL : (biased <= 0) ? 0 : 
+		((uint32_t)biased << 23) | (uint32_t)(mantissa & 0x7FFFFF);
+	float value;
+	memcpy(&value, &word, sizeof(value));
+	return value;
+}
+
+void SerialStream::formatExponent(serialFormatOut_t* out, bool negative, uint64_t mantissa, int32_t exponent, uint32_t precision) 
+{
+	//Scale into [1, 10) with single precision (hardware on the M4), tracking the power of ten.
+	static const float up[6] = {1e32f, 1e16f, 1e8f, 1e4f, 1e2f, 1e1f};
+	static const float down[6] = {1e-32f, 1e-16f, 1e-8f, 1e-4f, 1e-2f, 1e-1f};
+	static const float belowOne[6] = {1e-31f, 1e-15f, 1e-7f, 1e-3f, 1e-1f, 1.0f};
+	static const int32_t powers[6] = {32, 16, 8, 4, 2, 1};
+	int32_t power10 = 0;
+	
+	//Doubles beyond single precision's range (either way) are first brought 
+	// within 2^+-100 by 10^-+32 steps in 32-bit binary fixed point, so the float 
+	// below neither overflows nor flushes to zero. Costs ~1e-9 relative error per step.
+	if (mantissa) {
+		int32_t shift = 64 - __builtin_clzll(mantissa) - 32; // To 32 significant bits.
+		mantissa = (shift >= 0) ? mantissa >> shift : mantissa << -shift;
+		exponent += shift;
+		while (exponent > 100 - 32 || exponent < -100 - 31) {
+			bool large = (exponent > 0);
+			mantissa *= large ? 0xCFB11EADULL : 0x9DC5ADA8ULL; // 10^-32 = 0xCFB11EAD * 2^-138, 10^32 = 0x9DC5ADA8 * 2^75.
+			shift = 64 - __builtin_clzll(mantissa) - 32;
+			mantissa >>= shift;
+			exponent += shift + (large ? -138 : 75);
+			power10 += large ? 32 : -32;
+		}
+	}
+	float value = serialToFloat(mantissa, exponent);
+	
+	if (value != 0.0f) {
+		for (uint32_t i = 0; i < 6; i++) {
+			if (value >= up[i]) {
+				value *= down[i];
+				power10 += powers[i];
+			}
+		}
+		for (uint32_t i = 0; i < 6; i++) {
+			if (value < belowOne[i]) {
+				value *= up[i];
+				power10 -= powers[i];
+			}
+		}
+		
+		//Rounding up to 10.0 moves to the next power.
+		float half = 5.0f;
+		for (uint32_t i = 0; i <= precision; i++) {
+			half *= 0.1f;
+		}
+		if (value + half >= 10.0f) {
+			value *= 0.1f;
+			power10++;
+		}
+	}
+	
+	//Digits, from the scaled float's own bits:
+	uint32_t word;
+	memcpy(&word, &value, sizeof(word));
+	SerialStream::formatFixed(out, negative, (word & 0x7FFFFF) | (word ? 0x800000 : 0), 
+		(int32_t)((word >> 23) & 0xFF) - 150, precision);
+	
+	//Exponent, signed and at least two digits:
+	char number[8];
+	char* start = SerialStream::numToAscii(number + sizeof(number), power10 < 0 ? -power10 : power10, false, 10, 0);
+	if (start > number + sizeof(number) - 2) {
+		*(--start) = '0';
+	}
+	*(--start) = (power10 < 0) ? '-' : '+';
+	*(--start) = 'e';
+	SerialStream::formatBlock(out, start, number + sizeof(number) - start);
+}
+
+void SerialStream::formatDouble(serialFormatOut_t* out, char spec, uint32_t precision, double value) 
+{
+	//Take the double apart: sign, 11-bit exponent, 52-bit mantissa.
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bool negative = bits >> 63;
+	int32_t exponent = (bits >> 52) & 0x7FF;
+	uint64_t mantissa = bits & 0xFFFFFFFFFFFFFULL;
+	
+	if (exponent == 0x7FF) {
+		SerialStream::formatBlock(out, mantissa ? "nan" : (negative ? "-inf" : "inf"), mantissa ? 3 : 3 + negative);
+		return;
+	}
+	if (exponent) {
+		mantissa |= 1ULL << 52; // Implicit leading one, unless subnormal.
+	}
+	exponent = (exponent ? exponent : 1) - 1075;
+	
+	//Whole part over 64 bits: fixed notation is no use, so use exponent notation.
+	if (spec == 'e' || (exponent > 11)) {
+		SerialStream::formatExponent(out, negative, mantissa, exponent, precision);
+	}
+	else {
+		SerialStream::formatFixed(out, negative, mantissa, exponent, precision);
+	}
+}
+
+void SerialStream::formatFloat(serialFormatOut_t* out, char spec, uint32_t precision, float value) 
+{
+	//Take the float apart: sign, 8-bit exponent, 23-bit mantissa. Always fits fixed notation.
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bool negative = bits >> 31;
+	int32_t exponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	
+	if (exponent == 0xFF) {
+		SerialStream::formatBlock(out, mantissa ? "nan" : (negative ? "-inf" : "inf"), mantissa ? 3 : 3 + negative);
+		return;
+	}
+	if (exponent) {
+		mantissa |= 1UL << 23;
+	}
+	exponent = (exponent ? exponent : 1) - 150;
+	
+	if (spec == 'e' || exponent > 40) {
+		SerialStream::formatExponent(out, negative, mantissa, exponent, precision);
+	}
+	else {
+		SerialStream::formatFixed(out, negative, mantissa, exponent, precision);
+	}
+}
+
+
+void SerialStream::printf(const char* format, ...) 
+{
+	//Formats into a stack buffer, so the stream sees one WriteBlock per buffer-full.
+	char buffer[SERIAL_PRINTF_BUFF_LENGTH];
+	serialFormatOut_t out = {buffer, SERIAL_PRINTF_BUFF_LENGTH, 0, 0, this};
+	
+	va_list arg;
+	va_start(arg, format);
+	SerialStream::formatV(&out, format, arg);
 	va_end(arg);
+	
+	if (out.used) {
+		this->WriteBlock((const uint8_t*)buffer, out.used);
+	}
+}
+
+uint32_t SerialStream::vsnprintf(char* buffer, uint32_t size, const char* format, va_list arg) 
+{
+	//Formats into caller memory, keeping room for the null terminator.
+	serialFormatOut_t out = {buffer, size ? size - 1 : 0, 0, 0, NULL};
+	
+	SerialStream::formatV(&out, format, arg);
+	if (size) {
+		buffer[out.used] = '\0';
+	}
+	return out.total;
+}
+
+uint32_t SerialStream::snprintf(char* buffer, uint32_t size, const char* format, ...) 
+{
+	va_list arg;
+	va_start(arg, format);
+	uint32_t length = SerialStream::vsnprintf(buffer, size, format, arg);
+	va_end(arg);
+	return length;
+}
+
+
+template <typename... Args>
+void SerialStream::Print(const char* format, Args... args) 
+{
+	//Same stack buffer and single WriteBlock as printf.
+	char buffer[SERIAL_PRINTF_BUFF_LENGTH];
+	serialFormatOut_t out = {buffer, SERIAL_PRINTF_BUFF_LENGTH, 0, 0, this};
+	
+	SerialStream::printFields(&out, format, args...);
+	
+	if (out.used) {
+		this->WriteBlock((const uint8_t*)buffer, out.used);
+	}
+}
+
+const char* SerialStream::printLiteral(serialFormatOut_t* out, const char* format) 
+{
+	//Copies text up to the next field. Returns its specifier letter, or the terminator.
+	while (*format) {
+		const char* text = format;
+		while (*format && *format != '%') {
+			format++;
+		}
+		SerialStream::formatBlock(out, text, format - text);
+		
+		if (*format == 0 || format[1] != '%') {
+			return *format ? format + 1 : format;
+		}
+		SerialStream::formatBlock(out, "%", 1);
+		format += 2;
+	}
+	return format;
+}
+
+void SerialStream::printFields(serialFormatOut_t* out, const char* format) 
+{
+	//No arguments left: just the text (any extra specifiers print nothing).
+	uint32_t precision;
+	while (*(format = SerialStream::printLiteral(out, format))) {
+		format = SerialStream::specParse(format, &precision) + 1;
+	}
+}
+
+template <typename T, typename... Rest>
+void SerialStream::printFields(serialFormatOut_t* out, const char* format, T value, Rest... rest) 
+{
+	uint32_t precision;
+	format = SerialStream::printLiteral(out, format);
+	if (*format == 0) {
+		return; // More arguments than specifiers.
+	}
+	format = SerialStream::specParse(format, &precision);
+	SerialStream::printField(out, *format, precision, value);
+	SerialStream::printFields(out, format + 1, rest...);
+}
+
+template <typename T>
+void SerialStream::printField(serialFormatOut_t* out, char spec, uint32_t precision, T value) 
+{
+	static_assert(serialArgKind<T>::kind == serial_argInteger, "Print: unsupported argument type");
+	SerialStream::printInteger(out, spec, precision, (int64_t)value, (T)-1 < (T)0);
+}
+
+void SerialStream::printField(serialFormatOut_t* out, char spec, uint32_t precision, float value) 
+{
+	if (spec == 'f' || spec == 'e') {
+		SerialStream::formatFloat(out, spec, precision, value); // No promotion to double.
+	}
+}
+
+void SerialStream::printField(serialFormatOut_t* out, char spec, uint32_t precision, double value) 
+{
+	if (spec == 'f' || spec == 'e') {
+		SerialStream::formatDouble(out, spec, precision, value);
+	}
+}
+
+void SerialStream::printField(serialFormatOut_t* out, char spec, uint32_t, const char* value) 
+{
+	if (spec == 's') {
+		SerialStream::formatBlock(out, value, strlen(value));
+	}
+}
+
+void SerialStream::printField(serialFormatOut_t* out, char spec, uint32_t precision, char* value) 
+{
+	SerialStream::printField(out, spec, precision, (const char*)value);
+}
+
+void SerialStream::printInteger(serialFormatOut_t* out, char spec, uint32_t precision, int64_t value, bool signedValue) 
+{
+	//Signedness comes from the argument's type, base and prefix from the specifier.
+	char number[SERIAL_NUM_BUFF_LENGTH];
+	char* numberEnd = number + SERIAL_NUM_BUFF_LENGTH;
+	char* start;
+	
+	switch (spec) {
+		default:
+			return;
+		case 'c':
+			number[0] = (char)value;
+			SerialStream::formatBlock(out, number, 1);
+			return;
+		case 'd':
+		case 'i':
+		case 'u':
+			start = SerialStream::numToAscii(numberEnd, value, signedValue, 10, 0);
+			break;
+		case 'b':
+			start = SerialStream::numToAscii(numberEnd, value, false, 2, 32);
+			break;
+		case 'x':
+			start = SerialStream::numToAscii(numberEnd, value, false, 16, 0);
+			*(--start) = 'x';
+			*(--start) = '0';
+			break;
+		case 'o':
+			start = SerialStream::numToAscii(numberEnd, value, false, 8, 0);
+			*(--start) = '0';
+			break;
+		case 'q': // Q15 and Q31: the integer is the value scaled by 2^15 or 2^31.
+		case 'Q': {
+			bool negative = value < 0;
+			uint64_t magnitude = negative ? 0 - (uint64_t)value : (uint64_t)value;
+			SerialStream::formatFixed(out, negative, magnitude, (spec == 'q') ? -15 : -31, precision);
+			return;
+		}
+	}
+	SerialStream::formatBlock(out, start, numberEnd - start);
 }
 
 
@@ -206,30 +798,79 @@ int64_t SerialStream::ReadNum(uint32_t base)
 	
 	int64_t ret_val = 0;
 	int neg_flag = 1;
+	int16_t next;
+	int digit;
 	
-	// Step 1: Eat up whitespace and non-numerics.
-	while (this->Available() && (this->Peek() != '-') // While not a negative sign...
-			&& ((SerialAsciiInverse[this->Peek() + 1] < 0) // Or within valid characters
-			|| (SerialAsciiInverse[this->Peek() + 1] >= base))) {
+	// Step 1: Eat up whitespace and non-numerics. Peek() gives -1 when empty, 
+	//  which the table maps to -1 as well.
+	while ((next = this->Peek()) >= 0 && (next != '-') // While not a negative sign...
+			&& ((digit = SerialAsciiInverse[next + 1]) < 0 // Or within valid characters
+			|| (digit >= (int)base))) {
 		this->Read(); // Consume anything we can't convert.
 	}
 	
 	// Step 2: Negative flag.
-	if (this->Peek() == '-') {
+	if (next == '-') {
 		this->Read();
 		neg_flag = -1;
 	}
 	
-	// Step 3: Convert number.
-	while (this->Available() && SerialAsciiInverse[this->Peek() + 1] >= 0 
-		&& SerialAsciiInverse[this->Peek() + 1] < base) {
+	// Step 3: Convert number. One Peek and one lookup per character.
+	while ((digit = SerialAsciiInverse[this->Peek() + 1]) >= 0 && digit < (int)base) {
+		this->Read();
 		ret_val *= base; // Shift left one space
-		ret_val += SerialAsciiInverse[this->Read() + 1]; // Add next digit
+		ret_val += digit; // Add next digit
 	}
 	
 	return ret_val * neg_flag;
 }
 	
+bool serialTextToNum(const char* text, uint32_t base, int64_t* value) 
+{
+	uint64_t ret_val = 0;
+	bool negative = (*text == '-');
+	
+	text += negative;
+	if (*text == 0) {
+		return false;
+	}
+	while (*text) {
+		int digit = SerialAsciiInverse[(uint8_t)*(text++) + 1];
+		if (digit < 0 || digit >= (int)base || (ret_val >> 56)) {
+			return false; // Not a digit, or the next one could overflow.
+		}
+		ret_val = ret_val * base + digit;
+	}
+	*value = negative ? -(int64_t)ret_val : (int64_t)ret_val;
+	return true;
+}
+
+uint32_t serialCOBSEncode(const uint8_t* data, uint32_t length, uint8_t* encoded) 
+{
+	//Writing never gets ahead of reading by more than the headroom: one code 
+	// byte, plus one per full block.
+	uint8_t* code = encoded;
+	uint8_t* ptr = encoded + 1;
+	
+	for (uint32_t i = 0; i < length; i++) {
+		uint8_t byte = data[i];
+		if (byte) {
+			*(ptr++) = byte;
+			if (ptr - code == 0xFF) { // 254 bytes without a 0x00: code 0xFF, none implied.
+				*code = 0xFF;
+				code = ptr++;
+			}
+		}
+		else {
+			*code = ptr - code;
+			code = ptr++;
+		}
+	}
+	*code = ptr - code; // Last block; its 0x00 is implied and dropped by the receiver.
+	*(ptr++) = 0x00; // Delimiter.
+	return ptr - encoded;
+}
+	
 uint32_t SerialStream::scanf(const char* format, ...) 
 {
 	// Formatted read from port.
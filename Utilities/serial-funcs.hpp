@@ -15,6 +15,9 @@
 
 #include "stdarg.h"
 
+#define SERIAL_PRINTF_BUFF_LENGTH 96 // printf builds its output in a stack buffer this long, sent when full.
+#define SERIAL_PRECISION_DEFAULT 6 // Decimal places for %f, %e, %q and %Q without a .N precision (max 9).
+
 // Ascii lookup table for number conversions of arbitrary bases:
 char SerialAsciiTable[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
 // Values of ASCII table letters when converted to integers:
@@ -33,30 +36,225 @@ int SerialAsciiInverse[] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
 							//123 thru 255 invalid.
 							-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 
 							-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 
-							-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+							-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+static_assert(sizeof(SerialAsciiInverse) == 257 * sizeof(int), "SerialAsciiInverse: needs an entry for -1 and each of 0 thru 255");
+
+//Link statistics snapshot, as returned by the drivers' StatsGet(). 
+// Counters are free-running; compare two snapshots for rates.
+struct serialStats_t {
+	uint32_t bytesIn;		// Put into receive buffer
+	uint32_t bytesOut;		// Handed to the transmitter
+	uint32_t overrunErrors;	// Receive register overwritten before read - ISR latency
+	uint32_t framingErrors;	// Bad stop bit - line noise or wrong baud rate
+	uint32_t parityErrors;
+	uint32_t manchesterErrors;	// Preamble mismatch (USART Manchester mode only)
+	uint32_t rxDrops;		// Received bytes (or whole frames) lost to a full receive buffer
+	uint32_t txDrops;		// Bytes refused by a full transmit buffer
+	uint32_t rxPeak;		// Highest receive buffer occupancy seen
+	uint32_t txPeak;		// Highest transmit buffer occupancy seen
+	uint32_t interrupts;	// Calls to Update()
+	uint32_t linesDiscarded;	// Lines longer than the LineConfig maximum, dropped by LineGet()
+	uint32_t linesOverrun;	// Lines overwritten by new data while held, reported by LineRelease()
+};
+
+//A received line, left in place in the receive buffer: one span, or two 
+// when it wraps around the end. The delimiter is not included.
+struct serialLine_t {
+	const uint8_t* span[2];
+	uint32_t spanLength[2];
+	uint32_t length;		// Total of both spans.
+};
+
+//Line framing state, kept by each driver for its LineGet() and LineRelease().
+struct serialLineState_t {
+	uint32_t start;			// Buffer read index that scanned and held count from.
+	uint32_t scanned;		// Bytes already searched for the delimiter.
+	uint32_t held;			// Line handed out by LineGet(), with delimiter, awaiting release.
+	uint32_t maxLength;
+	uint32_t discarded;
+	uint32_t overrun;		// Held lines overwritten before release.
+	uint8_t delimiter;
+	bool discarding;		// Dropping the rest of an overlong line.
+};
+
+//Shared by the drivers' line functions: finds the next complete line in the 
+// receive buffer, dropping overlong ones, and releases it afterwards. The 
+// receive buffers overwrite their oldest data when full, so a line held 
+// while the buffer fills is lost: release returns false if that happened.
+template <class buffer_t>
+bool serialLineGet(buffer_t* buffer, serialLineState_t* state, serialLine_t* line);
+template <class buffer_t>
+bool serialLineRelease(buffer_t* buffer, serialLineState_t* state);
+
+//ReadNum's conversion on a whole string, e.g. a command argument: optional 
+// '-', then digits in base. False if anything else is there, or it's too long.
+bool serialTextToNum(const char* text, uint32_t base, int64_t* value);
+
+//COBS encoding, shared by SERIAL_LOG and serialPacket_c: each 0x00 becomes 
+// the distance to the next, and the frame ends with a 0x00 delimiter. Writes 
+// at most SERIAL_COBS_LENGTH(length) bytes and returns how many. Works in 
+// place if data is at least SERIAL_COBS_HEADROOM(length) bytes into encoded.
+#define SERIAL_COBS_LENGTH(length) ((length) + (length) / 254 + 2)
+#define SERIAL_COBS_HEADROOM(length) ((length) / 254 + 1)
+uint32_t serialCOBSEncode(const uint8_t* data, uint32_t length, uint8_t* encoded);
+
+class SerialStream;
+
+
+//Compile-time argument checking for Print(). Each argument type maps to the 
+// kind of field it can fill; types not listed here are refused.
+enum {serial_argNone, serial_argInteger, serial_argString, serial_argFloat};
+
+template <typename T> struct serialArgKind { static const int kind = serial_argNone; };
+template <> struct serialArgKind<bool> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<char> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<signed char> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<unsigned char> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<short> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<unsigned short> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<int> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<unsigned int> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<long> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<unsigned long> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<long long> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<unsigned long long> { static const int kind = serial_argInteger; };
+template <> struct serialArgKind<char*> { static const int kind = serial_argString; };
+template <> struct serialArgKind<const char*> { static const int kind = serial_argString; };
+template <> struct serialArgKind<float> { static const int kind = serial_argFloat; };
+template <> struct serialArgKind<double> { static const int kind = serial_argFloat; };
+
+//List of argument types, only ever used in decltype:
+template <typename... T> struct serialArgTypes_t { constexpr serialArgTypes_t() {} };
+template <typename... T> serialArgTypes_t<T...> serialArgTypes(T...);
+
+//Whether a specifier letter takes an argument of the given kind.
+constexpr bool serialSpecAccepts(char spec, int kind) {
+	return (kind == serial_argInteger) ? (spec == 'd' || spec == 'i' || spec == 'u' || spec == 'x' || 
+			spec == 'o' || spec == 'b' || spec == 'c' || spec == 'q' || spec == 'Q') : 
+		(kind == serial_argString) ? (spec == 's') : 
+		(kind == serial_argFloat) ? (spec == 'f' || spec == 'e') : false;
+}
+
+//Skips an optional .N precision, to reach the specifier letter.
+constexpr const char* serialSpecDigits(const char* format) {
+	return (*format >= '0' && *format <= '9') ? serialSpecDigits(format + 1) : format;
+}
+constexpr const char* serialSpecLetter(const char* format) {
+	return (*format == '.') ? serialSpecDigits(format + 1) : format;
+}
+
+//Walks the format string, matching each specifier to the next argument type.
+constexpr bool serialFormatCheck(const char* format, serialArgTypes_t<>) {
+	return (*format == 0) ? true : 
+		(*format != '%') ? serialFormatCheck(format + 1, serialArgTypes_t<>()) : 
+		(format[1] == '%') ? serialFormatCheck(format + 2, serialArgTypes_t<>()) : 
+		false; // Specifier without an argument.
+}
+template <typename T, typename... Rest>
+constexpr bool serialFormatCheck(const char* format, serialArgTypes_t<T, Rest...>) {
+	return (*format == 0) ? false : // Argument without a specifier.
+		(*format != '%') ? serialFormatCheck(format + 1, serialArgTypes_t<T, Rest...>()) : 
+		(format[1] == '%') ? serialFormatCheck(format + 2, serialArgTypes_t<T, Rest...>()) : 
+		serialSpecAccepts(*serialSpecLetter(format + 1), serialArgKind<T>::kind) && 
+			serialFormatCheck(serialSpecLetter(format + 1) + 1, serialArgTypes_t<Rest...>());
+}
+
+//Print() with the format string checked against the arguments at compile time. 
+// The format must be a string literal, e.g. SERIAL_PRINT(samUART1, "adc=%u\n", value);
+#define SERIAL_PRINT(stream, format, ...) do { \
+	static_assert(serialFormatCheck(format, decltype(serialArgTypes(__VA_ARGS__))()), \
+		"SERIAL_PRINT: format specifiers don't match the arguments"); \
+	(stream).Print(format, ##__VA_ARGS__); \
+} while (0)
+
+
+//Formatter output: a bounded buffer, handed to a stream each time it fills 
+// (printf), or truncated when there is no stream (snprintf).
+struct serialFormatOut_t {
+	char* buffer;
+	uint32_t size;
+	uint32_t used;
+	uint32_t total; // Characters produced, including any truncated.
+	SerialStream* stream;
+};
 
 class SerialStream {
 	public:
 		//Template for inheriting classes' functions:
-		virtual int16_t Read(void); // Note returns -1 if receive buffer empty.
-		virtual int16_t Peek(void);
-		virtual void Write(uint8_t byte);
-		virtual uint32_t Available(void);
+		virtual int16_t Read(void) = 0; // Note returns -1 if receive buffer empty.
+		virtual int16_t Peek(void) = 0;
+		virtual void Write(uint8_t byte) = 0;
+		virtual uint32_t Available(void) = 0;
+		
+		//Bulk versions of Write and Read. The defaults loop over the 
+		//  single-byte functions; drivers override them to move a whole 
+		//  block through their buffers at once. Both return bytes accepted.
+		virtual uint32_t WriteBlock(const uint8_t* data, uint32_t num_bytes);
+		virtual uint32_t ReadBlock(uint8_t* data, uint32_t num_bytes);
+		//Room in the transmit buffer, so writers (e.g. serialMux_c) can avoid 
+		//  partial writes. Streams without one report 0xFFFFFFFF.
+		virtual uint32_t WriteSpace(void);
 		
 		//Iterative extensions for basic Read and Write, with 
-		//  optional number-of-bytes specifier.
+		//  optional number-of-bytes specifier. ReadStr without a length 
+		//  trusts the buffer to hold a whole line - the drivers' LineGet() 
+		//  is the bounded, zero-copy alternative.
 		uint32_t ReadStr(char buffer[]);
 		uint32_t ReadStr(char buffer[], uint32_t num_bytes);
 		void WriteStr(char buffer[]);
 		void WriteStr(char buffer[], uint32_t num_bytes);
 		
-		//Works in progress: printf, scanf
+		//Formatted text, built up in a stack buffer and passed to WriteBlock in one go. 
+		// Specifiers: %d %i %u %x %o %b %c %s %%, and with an optional .N precision: 
+		// %f and %e (double), %q (Q15 in an int) and %Q (Q31). %e keeps about 7 
+		// significant digits; none of these use floating point library routines.
 		void printf(const char* format, ...);
+		//The same formatting into caller memory. Null-terminated if size > 0, and 
+		// returns the length the whole text would have had.
+		static uint32_t snprintf(char* buffer, uint32_t size, const char* format, ...);
+		static uint32_t vsnprintf(char* buffer, uint32_t size, const char* format, va_list arg);
+		
+		//Type-safe formatting, with the same specifiers as printf. Each field is 
+		// formatted according to its argument's actual type (so %u and 64-bit 
+		// values are always right) without va_list. Use SERIAL_PRINT to also 
+		// check the format string at compile time.
+		template <typename... Args>
+		void Print(const char* format, Args... args);
+		
+		//Works in progress: scanf
 		uint32_t scanf(const char* format, ...);
 		
-	private:
+	protected:
 		//Convert integer etc to ascii and send:
 		void PrintNum(int64_t value, bool signedValue, uint32_t base, uint32_t whitespace_pad);
+		
+		//Single-pass formatter behind printf and snprintf:
+		static void formatV(serialFormatOut_t* out, const char* format, va_list arg);
+		static void formatBlock(serialFormatOut_t* out, const char* text, uint32_t length);
+		//Print() field by field: literal text up to the next specifier, then the 
+		// specifier's argument, chosen by overloading on its type.
+		static const char* printLiteral(serialFormatOut_t* out, const char* format);
+		static void printFields(serialFormatOut_t* out, const char* format);
+		template <typename T, typename... Rest>
+		static void printFields(serialFormatOut_t* out, const char* format, T value, Rest... rest);
+		static const char* specParse(const char* format, uint32_t* precision);
+		template <typename T>
+		static void printField(serialFormatOut_t* out, char spec, uint32_t precision, T value);
+		static void printField(serialFormatOut_t* out, char spec, uint32_t precision, const char* value);
+		static void printField(serialFormatOut_t* out, char spec, uint32_t precision, char* value);
+		static void printField(serialFormatOut_t* out, char spec, uint32_t precision, float value);
+		static void printField(serialFormatOut_t* out, char spec, uint32_t precision, double value);
+		static void printInteger(serialFormatOut_t* out, char spec, uint32_t precision, int64_t value, bool signedValue);
+		
+		//Real numbers without floating point library routines. The value is 
+		// mantissa * 2^exponent, taken apart from the float or double's bits.
+		static void formatFixed(serialFormatOut_t* out, bool negative, uint64_t mantissa, int32_t exponent, uint32_t precision);
+		static void formatExponent(serialFormatOut_t* out, bool negative, uint64_t mantissa, int32_t exponent, uint32_t precision);
+		static void formatDouble(serialFormatOut_t* out, char spec, uint32_t precision, double value);
+		static void formatFloat(serialFormatOut_t* out, char spec, uint32_t precision, float value);
+		
+		//Integer to ascii, written backwards to finish just before end. Returns the start.
+		static char* numToAscii(char* end, int64_t value, bool signedValue, uint32_t base, uint32_t whitespace_pad);
 		//Convert ascii to integer (non-blocking):
 		int64_t ReadNum(uint32_t base);
 		
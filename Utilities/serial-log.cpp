@@ -0,0 +1,101 @@
+/*
+ * serial-log.cpp
+ * Deferred binary logging over any SerialStream.
+ *
+ * Created: 17/10/2026
+ */
+
+#include "string.h"
+
+
+template <typename... Args>
+void serialLogWrite(SerialStream* stream, uint32_t id, Args... args) 
+{
+	uint8_t record[SERIAL_LOG_RECORD_LENGTH];
+	uint8_t encoded[SERIAL_COBS_LENGTH(SERIAL_LOG_RECORD_LENGTH)];
+	
+	uint8_t* end = serialLogVarint(record, id);
+	end = serialLogArgs(end, record + SERIAL_LOG_RECORD_LENGTH, args...);
+	
+	stream->WriteBlock(encoded, serialCOBSEncode(record, end - record, encoded));
+}
+
+uint8_t* serialLogVarint(uint8_t* ptr, uint64_t value) 
+{
+	//Base 128, low bits first, top bit set on all but the last byte.
+	while (value >= 0x80) {
+		*(ptr++) = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	*(ptr++) = value;
+	return ptr;
+}
+
+uint8_t* serialLogArgs(uint8_t* ptr, uint8_t*) 
+{
+	return ptr;
+}
+
+template <typename T, typename... Rest>
+uint8_t* serialLogArgs(uint8_t* ptr, uint8_t* end, T value, Rest... rest) 
+{
+	if (end - ptr < 10) {
+		return ptr; // No room for another field - the host shows the rest as missing.
+	}
+	ptr = serialLogArg(ptr, end, value);
+	return serialLogArgs(ptr, end, rest...);
+}
+
+template <typename T>
+uint8_t* serialLogArg(uint8_t* ptr, uint8_t*, T value) 
+{
+	//Zigzag: small negative numbers become small varints too. Unsigned values 
+	// round-trip through int64_t bit for bit.
+	static_assert(serialArgKind<T>::kind == serial_argInteger, "SERIAL_LOG: unsupported argument type");
+	int64_t signedValue = (int64_t)value;
+	return serialLogVarint(ptr, ((uint64_t)signedValue << 1) ^ (uint64_t)(signedValue >> 63));
+}
+
+uint8_t* serialLogArg(uint8_t* ptr, uint8_t* end, const char* value) 
+{
+	uint32_t length = strlen(value);
+	uint32_t room = end - ptr - 1;
+	
+	length = (length < room) ? length : room;
+	ptr = serialLogVarint(ptr, length); // Room is under 128, so one byte.
+	memcpy(ptr, value, length);
+	return ptr + length;
+}
+
+uint8_t* serialLogArg(uint8_t* ptr, uint8_t* end, char* value) 
+{
+	return serialLogArg(ptr, end, (const char*)value);
+}
+
+uint8_t* serialLogArg(uint8_t* ptr, uint8_t*, float value) 
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	for (uint32_t i = 0; i < 4; i++) {
+		*(ptr++) = bits >> (8 * i);
+	}
+	return ptr;
+}
+
+uint8_t* serialLogArg(uint8_t* ptr, uint8_t* end, double value) 
+{
+	//Sent as single precision, converted from the bits (no double routines).
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	int32_t exponent = (bits >> 52) & 0x7FF;
+	uint64_t mantissa = bits & 0xFFFFFFFFFFFFFULL;
+	float single;
+	
+	if (exponent == 0x7FF) {
+		single = mantissa ? __builtin_nanf("") : __builtin_inff();
+	}
+	else {
+		single = serialToFloat(mantissa | (exponent ? 1ULL << 52 : 0), (exponent ? exponent : 1) - 1075);
+	}
+	return serialLogArg(ptr, end, (bits >> 63) ? -single : single);
+}
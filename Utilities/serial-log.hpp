@@ -0,0 +1,62 @@
+/*
+ * serial-log.hpp
+ * Deferred binary logging over any SerialStream.
+ *
+ * SERIAL_LOG(stream, "format", args...) takes printf-style formats, but the 
+ * target never formats anything: the format string is placed in the 
+ * "serial_log" section of the build, and only its offset there (the ID) and 
+ * the raw arguments go down the wire. The host tool Tools/serial-log-decode.cpp 
+ * reads the strings back out of the ELF file and rebuilds each line.
+ *
+ * Each record is: varint ID, then per argument - integers as zigzag varints, 
+ * %f/%e reals as 4-byte little-endian floats, strings as a varint length and 
+ * the bytes. The record is COBS-encoded and ends with a 0x00 byte, so the host 
+ * re-synchronises after lost bytes.
+ *
+ * The strings take flash unless the linker script marks the section (INFO): 
+ * it stays in the ELF file, with the same IDs, but isn't loaded. Not NOLOAD, 
+ * which leaves the strings out of the file too, so the decoder can't find them.
+ *
+ * Created: 17/10/2026
+ */
+
+
+#ifndef SERIAL_LOG_HPP_
+#define SERIAL_LOG_HPP_
+
+#include "serial-funcs.hpp"
+
+#define SERIAL_LOG_RECORD_LENGTH 64 // Largest record before encoding; longer argument lists are cut short.
+
+//Start of the format string section, from the linker.
+extern const char __start_serial_log[];
+
+//Log with the format string checked against the arguments at compile time, 
+// as SERIAL_PRINT. Strings are the only arguments sent at variable length.
+#define SERIAL_LOG(stream, format, ...) do { \
+	static_assert(serialFormatCheck(format, decltype(serialArgTypes(__VA_ARGS__))()), \
+		"SERIAL_LOG: format specifiers don't match the arguments"); \
+	static const char serialLogFormat[] __attribute__((section("serial_log"), used)) = format; \
+	serialLogWrite(&(stream), serialLogFormat - __start_serial_log, ##__VA_ARGS__); \
+} while (0)
+
+
+//Builds one record and sends it with a single WriteBlock.
+template <typename... Args>
+void serialLogWrite(SerialStream* stream, uint32_t id, Args... args);
+
+//Record building, one argument at a time. Each returns the new end of the record.
+uint8_t* serialLogVarint(uint8_t* ptr, uint64_t value);
+uint8_t* serialLogArgs(uint8_t* ptr, uint8_t* end);
+template <typename T, typename... Rest>
+uint8_t* serialLogArgs(uint8_t* ptr, uint8_t* end, T value, Rest... rest);
+template <typename T>
+uint8_t* serialLogArg(uint8_t* ptr, uint8_t* end, T value);
+uint8_t* serialLogArg(uint8_t* ptr, uint8_t* end, const char* value);
+uint8_t* serialLogArg(uint8_t* ptr, uint8_t* end, char* value);
+uint8_t* serialLogArg(uint8_t* ptr, uint8_t* end, float value);
+uint8_t* serialLogArg(uint8_t* ptr, uint8_t* end, double value);
+
+#include "serial-log.cpp"
+
+#endif /* SERIAL_LOG_HPP_ */
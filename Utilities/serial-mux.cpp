@@ -0,0 +1,167 @@
+/*
+ * serial-mux.cpp
+ * Several logical channels sharing one serial port.
+ *
+ * Created: 17/10/2026
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+//Channels:
+
+serialMuxChannel_c::serialMuxChannel_c() 
+{
+}
+
+uint32_t serialMuxChannel_c::Available(void) {
+	return this->recieveBuffer.Available();
+}
+int16_t serialMuxChannel_c::Read(void) {
+	if (this->recieveBuffer.Available())
+		return this->recieveBuffer.Pop();
+	else
+		return -1;
+}
+int16_t serialMuxChannel_c::Peek(void) {
+	if (this->recieveBuffer.Available())
+		return this->recieveBuffer.Peek();
+	else
+		return -1;
+}
+void serialMuxChannel_c::Write(uint8_t byte) {
+	this->transmitBuffer.Push(byte);
+}
+uint32_t serialMuxChannel_c::WriteBlock(const uint8_t* data, uint32_t num_bytes) {
+	return this->transmitBuffer.PushN(data, num_bytes);
+}
+uint32_t serialMuxChannel_c::ReadBlock(uint8_t* data, uint32_t num_bytes) {
+	return this->recieveBuffer.PopN(data, num_bytes);
+}
+uint32_t serialMuxChannel_c::WriteSpace(void) {
+	return this->transmitBuffer.Space();
+}
+
+serialStats_t serialMuxChannel_c::StatsGet(void) {
+	serialStats_t snapshot = {};
+	snapshot.rxDrops = this->recieveBuffer.DroppedCount();
+	snapshot.txDrops = this->transmitBuffer.DroppedCount();
+	snapshot.rxPeak = this->recieveBuffer.HighWaterMark();
+	snapshot.txPeak = this->transmitBuffer.HighWaterMark();
+	return snapshot;
+}
+
+uint32_t serialMuxChannel_c::MuxPending(void) {
+	return this->transmitBuffer.Available();
+}
+uint32_t serialMuxChannel_c::MuxTake(uint8_t* data, uint32_t num_bytes) {
+	return this->transmitBuffer.PopN(data, num_bytes);
+}
+uint32_t serialMuxChannel_c::MuxGive(const uint8_t* data, uint32_t num_bytes) {
+	return this->recieveBuffer.PushN(data, num_bytes);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//Multiplexer:
+
+serialMux_c::serialMux_c(SerialStream* port) : 
+	port(port), link(port, serial_packetCOBS, serial_packetCRC16, serialMux_c::receiveHandler, this), 
+	next(0), unknownChannel(0)
+{
+	for (uint32_t i = 0; i < SERIAL_MUX_CHANNELS; i++) {
+		this->priority[i] = 0;
+		this->share[i] = 1;
+		this->deficit[i] = 0;
+	}
+}
+
+serialMuxChannel_c* serialMux_c::Channel(uint32_t channel) 
+{
+	return (channel < SERIAL_MUX_CHANNELS) ? &this->channels[channel] : NULL;
+}
+
+void serialMux_c::ChannelConfig(uint32_t channel, uint8_t priority, uint8_t share) 
+{
+	if (channel < SERIAL_MUX_CHANNELS) {
+		this->priority[channel] = priority;
+		this->share[channel] = share ? share : 1;
+	}
+}
+
+uint32_t serialMux_c::Update(void) 
+{
+	uint8_t chunk[1 + SERIAL_MUX_CHUNK];
+	uint32_t sent = 0;
+	int32_t channel;
+	
+	//Only whole chunks are sent, so the port never cuts one short.
+	while (this->port->WriteSpace() >= SERIAL_MUX_FRAMED_LENGTH && (channel = this->schedule()) >= 0) {
+		chunk[0] = channel;
+		uint32_t count = this->channels[channel].MuxTake(chunk + 1, SERIAL_MUX_CHUNK);
+		this->deficit[channel] -= count;
+		this->link.Send(chunk, count + 1);
+		sent += count;
+	}
+	
+	this->link.Poll();
+	return sent;
+}
+
+int32_t serialMux_c::schedule(void) 
+{
+	int32_t chosen = -1;
+	bool waiting = false;
+	
+	//Highest priority channel with data and credit; ties go round robin.
+	for (uint32_t i = 0; i < SERIAL_MUX_CHANNELS; i++) {
+		uint32_t index = (this->next + i) % SERIAL_MUX_CHANNELS;
+		if (this->channels[index].MuxPending() == 0) {
+			this->deficit[index] = 0; // Idle channels bank no credit.
+			continue;
+		}
+		waiting = true;
+		if (this->deficit[index] > 0 && (chosen < 0 || this->priority[index] > this->priority[chosen])) {
+			chosen = index;
+		}
+	}
+	if (chosen < 0 && waiting) {
+		//Everyone waiting is out of credit: start a new round.
+		for (uint32_t i = 0; i < SERIAL_MUX_CHANNELS; i++) {
+			if (this->channels[i].MuxPending()) {
+				this->deficit[i] += this->share[i] * SERIAL_MUX_QUANTUM;
+			}
+		}
+		return this->schedule();
+	}
+	if (chosen >= 0) {
+		this->next = (chosen + 1) % SERIAL_MUX_CHANNELS;
+	}
+	return chosen;
+}
+
+void serialMux_c::receiveHandler(void* context, const uint8_t* packet, uint32_t length) 
+{
+	serialMux_c* mux = (serialMux_c*)context;
+	
+	if (length == 0 || packet[0] >= SERIAL_MUX_CHANNELS) {
+		mux->unknownChannel++;
+		return;
+	}
+	mux->channels[packet[0]].MuxGive(packet + 1, length - 1); // Excess is dropped, and counted in the channel's StatsGet().rxDrops.
+}
+
+
+uint32_t serialMux_c::UnknownChannelCount(void) 
+{
+	return this->unknownChannel;
+}
+
+uint32_t serialMux_c::CRCErrorCount(void) 
+{
+	return this->link.CRCErrorCount();
+}
+
+uint32_t serialMux_c::FramingErrorCount(void) 
+{
+	return this->link.FramingErrorCount();
+}
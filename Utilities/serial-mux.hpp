@@ -0,0 +1,109 @@
+/*
+ * serial-mux.hpp
+ * Several logical channels sharing one serial port.
+ *
+ * Each channel is a SerialStream of its own (printf, Print, serialParser_c 
+ * etc all work), with its own buffers. serialMux_c::Update() moves 
+ * data between the channels and the port: outgoing data is cut into chunks 
+ * of up to SERIAL_MUX_CHUNK bytes, tagged with the channel number and sent as 
+ * COBS + CRC-16 packets (see serial-packet.hpp); incoming packets are checked 
+ * and handed to the channel they are tagged for.
+ *
+ * Scheduling: when several channels have data waiting, the one with the 
+ * highest priority goes first, as long as it has credit left. Credit is 
+ * topped up in proportion to each channel's share (deficit round robin), so 
+ * under load every channel gets its share of the line - a busy telemetry 
+ * channel can't lock out the console, and a high priority console still 
+ * jumps the queue when it has something to say. Idle channels bank no credit.
+ *
+ * Tools/serial-mux-host.cpp is the PC end: console on stdin/stdout, the other 
+ * channels to files.
+ *
+ * Created: 17/10/2026
+ */
+
+
+#ifndef SERIAL_MUX_HPP_
+#define SERIAL_MUX_HPP_
+
+#include "CircBuf.hpp"
+#include "serial-funcs.hpp"
+#include "serial-packet.hpp"
+
+#define SERIAL_MUX_CHANNELS 4		// Channel numbers 0 to SERIAL_MUX_CHANNELS - 1.
+#define SERIAL_MUX_BUFF_LENGTH 256	// Per channel and direction, power of two.
+#define SERIAL_MUX_CHUNK 32			// Most data bytes per packet on the wire.
+#define SERIAL_MUX_QUANTUM 64		// Credit per round for a share of 1, in bytes.
+
+//Largest chunk once framed: channel byte, data, CRC-16, COBS code and delimiter.
+#define SERIAL_MUX_FRAMED_LENGTH (1 + SERIAL_MUX_CHUNK + 2 + 2)
+
+
+class serialMuxChannel_c: public SerialStream {
+	public:
+		serialMuxChannel_c();
+		
+		//SerialStream interface. Writes that don't fit are dropped, as with 
+		// the drivers. One writer and one reader per channel.
+		uint32_t Available(void);
+		int16_t Read(void);
+		int16_t Peek(void);
+		void Write(uint8_t byte);
+		uint32_t WriteBlock(const uint8_t* data, uint32_t num_bytes);
+		uint32_t ReadBlock(uint8_t* data, uint32_t num_bytes);
+		uint32_t WriteSpace(void);
+		
+		//Buffer counters: rxDrops (data arrived with the receive buffer full), 
+		// txDrops, rxPeak and txPeak. The rest are left zero.
+		serialStats_t StatsGet(void);
+		
+		//Link side, used by serialMux_c: take data to send, give data received.
+		uint32_t MuxPending(void);
+		uint32_t MuxTake(uint8_t* data, uint32_t num_bytes);
+		uint32_t MuxGive(const uint8_t* data, uint32_t num_bytes);
+		
+	private:
+		CircBuf_c<uint8_t, SERIAL_MUX_BUFF_LENGTH, circbuf_dropNewest, true> recieveBuffer;
+		CircBuf_c<uint8_t, SERIAL_MUX_BUFF_LENGTH, circbuf_dropNewest, true> transmitBuffer;
+};
+
+
+class serialMux_c {
+	public:
+		//Initialiser: the port to share, e.g. &samUART1. All channels start at 
+		// priority 0 and share 1.
+		serialMux_c(SerialStream* port);
+		
+		//Channel access, NULL for a bad channel number.
+		serialMuxChannel_c* Channel(uint32_t channel);
+		//Scheduling: higher priority is sent first; share (1 to 255) sets the 
+		// channel's part of the bandwidth when channels compete.
+		void ChannelConfig(uint32_t channel, uint8_t priority, uint8_t share);
+		
+		//Sends chunks while the port has room for them, and delivers whatever 
+		// has arrived. Call often, e.g. from the main loop. Returns bytes sent.
+		uint32_t Update(void);
+		
+		//Packets received for channels that don't exist, and link errors.
+		uint32_t UnknownChannelCount(void);
+		uint32_t CRCErrorCount(void);
+		uint32_t FramingErrorCount(void);
+	
+	private:
+		//Next channel to send from, or -1 if none has anything waiting.
+		int32_t schedule(void);
+		static void receiveHandler(void* context, const uint8_t* packet, uint32_t length);
+		
+		SerialStream* port;
+		serialPacket_c link;
+		serialMuxChannel_c channels[SERIAL_MUX_CHANNELS];
+		uint8_t priority[SERIAL_MUX_CHANNELS];
+		uint8_t share[SERIAL_MUX_CHANNELS];
+		int32_t deficit[SERIAL_MUX_CHANNELS];	// Credit in bytes, may go negative by one chunk.
+		uint32_t next;							// Round robin start, for equal priorities.
+		uint32_t unknownChannel;
+};
+
+#include "serial-mux.cpp"
+
+#endif /* SERIAL_MUX_HPP_ */
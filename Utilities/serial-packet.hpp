@@ -0,0 +1,95 @@
+/*
+ * serial-packet.hpp
+ * Binary packet framing over any SerialStream: COBS or SLIP, with a CRC.
+ *
+ * Send() appends the CRC and encodes the packet on the way out. Received 
+ * bytes are decoded one at a time as they arrive (from Poll() or Receive()), 
+ * so nothing waits for a whole frame to be buffered twice. Each complete 
+ * packet with a good CRC goes to the handler; damaged ones are counted and 
+ * dropped, and the decoder picks up again at the next delimiter.
+ *
+ * COBS costs at most one byte per 254 plus the 0x00 delimiter; SLIP (RFC 1055) 
+ * is simpler but can double the size of unlucky data.
+ * CRCs: CRC-16/CCITT-FALSE (polynomial 0x1021, sent high byte first) or 
+ * CRC-32 as used by Ethernet and zlib (sent low byte first).
+ *
+ * Created: 17/10/2026
+ */
+
+
+#ifndef SERIAL_PACKET_HPP_
+#define SERIAL_PACKET_HPP_
+
+#include "serial-funcs.hpp"
+
+#define SERIAL_PACKET_LENGTH 256	// Largest packet, including its CRC.
+#define SERIAL_PACKET_CHUNK 32		// Bytes taken from the stream per ReadBlock in Poll().
+
+enum {serial_packetCOBS, serial_packetSLIP};
+enum {serial_packetCRCNone = 0, serial_packetCRC16 = 2, serial_packetCRC32 = 4}; // Value is the CRC size.
+
+//Called with each good packet, CRC removed. The packet is only valid during the call.
+typedef void (*serialPacketHandler_t)(void* context, const uint8_t* packet, uint32_t length);
+
+//Table-driven CRCs, one lookup per byte. Pass the previous result to continue a CRC.
+uint16_t serialCRC16(const uint8_t* data, uint32_t length, uint16_t crc = 0xFFFF);
+uint32_t serialCRC32(const uint8_t* data, uint32_t length, uint32_t crc = 0);
+
+
+class serialPacket_c {
+	public:
+		//Initialiser: stream to use, serial_packetCOBS or SLIP, serial_packetCRC*, 
+		// and the handler for received packets (context is passed back to it).
+		serialPacket_c(SerialStream* stream, uint32_t framing, uint32_t crc, 
+			serialPacketHandler_t handler, void* context);
+		
+		//Sends one packet (up to SERIAL_PACKET_LENGTH less the CRC). Returns 
+		// false if the packet is too long, or the stream didn't take all of it - 
+		// the receiver then drops it on the CRC. Empty packets need a CRC, as 
+		// otherwise they look like idle delimiters and aren't delivered.
+		bool Send(const uint8_t* data, uint32_t length);
+		
+		//Decodes whatever the stream has received; returns packets delivered.
+		uint32_t Poll(void);
+		//Decodes bytes obtained some other way (e.g. from DMA).
+		uint32_t Receive(const uint8_t* data, uint32_t length);
+		
+		//Counters: good packets, CRC failures, and frames that were too long or 
+		// badly encoded.
+		uint32_t PacketCount(void);
+		uint32_t CRCErrorCount(void);
+		uint32_t FramingErrorCount(void);
+	
+	private:
+		//Transmit: COBS frames are encoded whole in txBlock; SLIP bytes are 
+		// escaped into it a byte at a time, flushed when it fills.
+		void sendByte(uint8_t byte);
+		void sendFlush(void);
+		//Receive: end of frame, with validation and delivery.
+		bool frameEnd(void);
+		
+		SerialStream* stream;
+		uint32_t framing;
+		uint32_t crcSize;
+		serialPacketHandler_t handler;
+		void* context;
+		
+		uint8_t txBlock[SERIAL_COBS_LENGTH(SERIAL_PACKET_LENGTH)];
+		uint32_t txUsed;
+		bool txFailed;
+		
+		uint8_t rxBuffer[SERIAL_PACKET_LENGTH];
+		uint32_t rxUsed;
+		uint32_t rxRemaining;	// COBS: data bytes left in the current block.
+		bool rxZeroPending;		// COBS: block ended in an (implied) 0x00.
+		bool rxEscape;			// SLIP: last byte was ESC.
+		bool rxBad;				// Drop the rest of this frame.
+		
+		uint32_t packets;
+		uint32_t crcErrors;
+		uint32_t framingErrors;
+};
+
+#include "serial-packet.cpp"
+
+#endif /* SERIAL_PACKET_HPP_ */
@@ -0,0 +1,231 @@
+/*
+ * serial-parse.cpp
+ * Resumable scanf-style parser, fed bytes as they arrive.
+ *
+ * Created: 17/10/2026
+ */
+
+
+static inline bool serialIsSpace(uint8_t byte) {
+	return (byte == ' ') || (byte == '\t') || (byte == '\r') || (byte == '\n');
+}
+
+
+serialParser_c::serialParser_c(const char* format) : 
+	pendingHead(0), pendingCount(0) 
+{
+	this->Begin(format);
+}
+
+void serialParser_c::Begin(const char* format) 
+{
+	this->format = format;
+	this->Reset();
+}
+
+void serialParser_c::Reset(void) 
+{
+	this->position = this->format;
+	this->status = serial_parseBusy;
+	this->fields = 0;
+	this->textUsed = 0;
+	this->formatNext();
+}
+
+void serialParser_c::formatNext(void) 
+{
+	this->spec = 0;
+	if (this->position == NULL || *this->position == 0) {
+		this->status = serial_parseDone;
+		return;
+	}
+	if (this->position[0] != '%' || this->position[1] == '%') {
+		return; // Literal text.
+	}
+	
+	//Precision is allowed (so printf formats can be reused) but ignored.
+	const char* letter = serialSpecLetter(this->position + 1);
+	this->position = letter + 1;
+	this->spec = *letter;
+	this->negative = false;
+	this->prefixed = false;
+	this->digits = 0;
+	this->accumulator = 0;
+	
+	switch (this->spec) {
+		case 'd':
+		case 'i':
+		case 'u': this->base = 10; break;
+		case 'x': this->base = 16; break;
+		case 'o': this->base = 8; break;
+		case 'b': this->base = 2; break;
+		case 'c': break;
+		case 's': 
+			if (this->textUsed < SERIAL_PARSE_TEXT_LENGTH) {
+				this->text[this->textUsed] = '\0'; // Empty until the first character.
+			}
+			break;
+		default: 
+			this->status = serial_parseError; // Unknown specifier.
+			break;
+	}
+}
+
+void serialParser_c::fieldComplete(int64_t value) 
+{
+	if (this->fields < SERIAL_PARSE_FIELDS) {
+		this->values[this->fields] = value;
+	}
+	this->fields++;
+	this->status = serial_parseField;
+	this->formatNext(); // Becomes serial_parseDone if that was the last element.
+}
+
+uint32_t serialParser_c::Feed(const uint8_t* data, uint32_t length) 
+{
+	uint32_t used = 0;
+	
+	if (this->status == serial_parseField) {
+		this->status = serial_parseBusy;
+	}
+	
+	while (used < length && this->status == serial_parseBusy) {
+		uint8_t byte = data[used];
+		
+		if (this->spec == 0) {
+			//Literal text. Whitespace matches any amount of whitespace, including none.
+			char expected = *this->position;
+			if (serialIsSpace(expected)) {
+				if (serialIsSpace(byte)) {
+					used++;
+					//At the end of the format, one whitespace byte (e.g. the line ending) finishes it.
+					const char* rest = this->position;
+					while (serialIsSpace(*rest)) {
+						rest++;
+					}
+					if (*rest == 0) {
+						this->position = rest;
+						this->formatNext();
+					}
+				}
+				else {
+					this->position++;
+					this->formatNext();
+				}
+			}
+			else if (serialIsSpace(byte) && this->position == this->format) {
+				used++; // Leftovers from the last line ending, before the format starts.
+			}
+			else {
+				used++;
+				if (byte == expected) {
+					this->position += (expected == '%') ? 2 : 1;
+					this->formatNext();
+				}
+				else {
+					this->status = serial_parseError;
+				}
+			}
+		}
+		else if (this->spec == 'c') {
+			used++;
+			this->fieldComplete(byte);
+		}
+		else if (this->spec == 's') {
+			if (!serialIsSpace(byte)) {
+				used++;
+				if (this->textUsed + this->digits + 1 < SERIAL_PARSE_TEXT_LENGTH) {
+					this->text[this->textUsed + this->digits++] = byte;
+				}
+				else if (this->digits == 0) {
+					this->digits = 1; // No room left: the word is dropped, but still ends the field.
+				}
+			}
+			else if (this->digits == 0) {
+				used++; // Leading whitespace.
+			}
+			else {
+				uint32_t start = this->textUsed;
+				if (start + this->digits < SERIAL_PARSE_TEXT_LENGTH) {
+					this->text[start + this->digits] = '\0';
+					this->textUsed = start + this->digits + 1;
+				}
+				this->fieldComplete(start);
+			}
+		}
+		else {
+			//Numbers: one table lookup, then whichever case the byte fits.
+			int digit = SerialAsciiInverse[byte + 1];
+			if (digit >= 0 && digit < this->base) {
+				used++;
+				this->accumulator = this->accumulator * this->base + digit;
+				this->digits++;
+			}
+			else if (this->digits == 0) {
+				used++;
+				if (byte == '-' && !this->negative && (this->spec == 'd' || this->spec == 'i')) {
+					this->negative = true;
+				}
+				else if (!serialIsSpace(byte) || this->negative) {
+					this->status = serial_parseError;
+				}
+			}
+			else if (this->digits == 1 && this->accumulator == 0 && !this->prefixed 
+					&& (((byte | 0x20) == 'x' && this->base == 16) || ((byte | 0x20) == 'b' && this->base == 2))) {
+				used++; // 0x or 0b prefix, as printf writes them.
+				this->prefixed = true;
+				this->digits = 0;
+			}
+			else {
+				//Not consumed: the terminator may be matched by the format next.
+				int64_t value = this->accumulator;
+				this->fieldComplete(this->negative ? -value : value);
+			}
+		}
+	}
+	return used;
+}
+
+uint32_t serialParser_c::Poll(SerialStream* stream) 
+{
+	if (this->status == serial_parseField) {
+		this->status = serial_parseBusy;
+	}
+	
+	while (this->status == serial_parseBusy) {
+		if (this->pendingHead == this->pendingCount) {
+			this->pendingHead = 0;
+			this->pendingCount = stream->ReadBlock(this->pending, SERIAL_PARSE_CHUNK);
+			if (this->pendingCount == 0) {
+				break;
+			}
+		}
+		this->pendingHead += this->Feed(this->pending + this->pendingHead, 
+			this->pendingCount - this->pendingHead);
+	}
+	return this->status;
+}
+
+uint32_t serialParser_c::Status(void) 
+{
+	return this->status;
+}
+
+uint32_t serialParser_c::Fields(void) 
+{
+	return this->fields;
+}
+
+int64_t serialParser_c::Value(uint32_t field) 
+{
+	return (field < this->fields && field < SERIAL_PARSE_FIELDS) ? this->values[field] : 0;
+}
+
+const char* serialParser_c::Text(uint32_t field) 
+{
+	if (field >= this->fields || field >= SERIAL_PARSE_FIELDS 
+			|| this->values[field] >= this->textUsed) {
+		return "";
+	}
+	return &this->text[this->values[field]];
+}
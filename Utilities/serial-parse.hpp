@@ -0,0 +1,98 @@
+/*
+ * serial-parse.hpp
+ * Resumable scanf-style parser, fed bytes as they arrive.
+ *
+ * Unlike SerialStream::scanf, nothing is lost or split when a line arrives 
+ * over several interrupts: the parser keeps its place in the format and in 
+ * the current field between calls, and a number is only finished by the 
+ * first byte that can't be part of it. Each byte costs one SerialAsciiInverse 
+ * lookup.
+ *
+ * Format: %d %i (signed decimal), %u, %x, %o, %b (unsigned, 0x/0b prefix 
+ * optional), %c (any one byte), %s (one word, up to whitespace), %%. Numbers 
+ * and words skip leading whitespace, a space in the format matches any run of 
+ * whitespace (at the end of the format, just one byte, so a trailing \n ends 
+ * the parse on the line ending), and other characters must match exactly. 
+ * Whitespace before the start of the format is skipped. e.g.
+ *     serialParser_c cmd("set %s %d\n");
+ *     if (cmd.Poll(&samUART1) == serial_parseDone) { ... cmd.Text(0), cmd.Value(1) ... cmd.Reset(); }
+ *
+ * Created: 17/10/2026
+ */
+
+
+#ifndef SERIAL_PARSE_HPP_
+#define SERIAL_PARSE_HPP_
+
+#include "serial-funcs.hpp"
+
+#define SERIAL_PARSE_FIELDS 8		// Fields stored per format; any beyond this are parsed but not kept.
+#define SERIAL_PARSE_TEXT_LENGTH 32	// Storage for all %s words of one format, including terminators.
+#define SERIAL_PARSE_CHUNK 16		// Bytes taken from the stream per ReadBlock in Poll().
+
+//Parser status:
+//	busy: waiting for more bytes.
+//	field: a field has just been completed; Fields() is its number plus one.
+//	done: the last field (or literal) is complete, and so is the format.
+//	error: a byte didn't match the format. Call Reset() to start again.
+enum {serial_parseBusy, serial_parseField, serial_parseDone, serial_parseError};
+
+
+class serialParser_c {
+	public:
+		//Initialiser:
+		serialParser_c(const char* format = NULL);
+		//Parse with a new format, from the start.
+		void Begin(const char* format);
+		//Back to the start of the format, clearing stored fields. Bytes already 
+		// taken from a stream by Poll() are kept for the next parse.
+		void Reset(void);
+		
+		//Parses from a block of bytes, stopping after each field completes, at 
+		// the end of the format, or on an error. Returns bytes consumed; a byte 
+		// that ends a number is left for the next call.
+		uint32_t Feed(const uint8_t* data, uint32_t length);
+		//Takes bytes from the stream until a field completes or it runs dry, 
+		// and returns the status. Call again to carry on.
+		uint32_t Poll(SerialStream* stream);
+		
+		uint32_t Status(void);
+		//Fields completed so far, and their values. Text() is for %s fields, 
+		// and Value() gives the byte for %c.
+		uint32_t Fields(void);
+		int64_t Value(uint32_t field);
+		const char* Text(uint32_t field);
+	
+	private:
+		//Stores the current field's value and moves on in the format.
+		void fieldComplete(int64_t value);
+		//Moves to the next format element, setting up spec and base if it is a field.
+		void formatNext(void);
+		
+		const char* format;
+		const char* position;	// Next format element.
+		uint32_t status;
+		
+		//Current field:
+		char spec;				// Specifier letter, or 0 while matching literals.
+		uint8_t base;
+		bool negative;
+		bool prefixed;
+		uint32_t digits;		// Digits (or %s characters) so far.
+		uint64_t accumulator;
+		
+		//Completed fields:
+		uint32_t fields;
+		int64_t values[SERIAL_PARSE_FIELDS]; // %s fields hold their offset in text.
+		char text[SERIAL_PARSE_TEXT_LENGTH];
+		uint32_t textUsed;
+		
+		//Bytes read from a stream but not yet parsed:
+		uint8_t pending[SERIAL_PARSE_CHUNK];
+		uint32_t pendingHead;
+		uint32_t pendingCount;
+};
+
+#include "serial-parse.cpp"
+
+#endif /* SERIAL_PARSE_HPP_ */
@@ -0,0 +1,179 @@
+/*
+ * serial-shell.cpp
+ * Command console over a UART or USART, dispatched from a constant table.
+ *
+ * Created: 17/10/2026
+ */
+
+
+serialShell_c::serialShell_c(const serialCommand_t* commands, uint32_t count) : 
+	commands(commands), count(count), argCount(0), out(NULL)
+{
+}
+
+template <class port_t>
+uint32_t serialShell_c::Poll(port_t* port) 
+{
+	serialLine_t received;
+	
+	if (!port->LineGet(&received)) {
+		return serial_shellIdle;
+	}
+	
+	//Cut short, it would be a different command - so don't run any of it.
+	uint32_t length = received.length;
+	if (length > SERIAL_SHELL_LINE_LENGTH) {
+		port->LineRelease();
+		port->printf("line too long\n");
+		return serial_shellTooLong;
+	}
+	
+	//One copy out of the receive buffer (which may wrap), so the buffer is 
+	// free again before the handler runs, however long it takes.
+	memcpy(this->line, received.span[0], received.spanLength[0]);
+	memcpy(this->line + received.spanLength[0], received.span[1], received.spanLength[1]);
+	if (!port->LineRelease()) {
+		port->printf("line overrun\n");
+		return serial_shellOverrun;
+	}
+	
+	return this->Execute(this->line, length, port);
+}
+
+uint32_t serialShell_c::Execute(char* line, uint32_t length, SerialStream* out) 
+{
+	this->out = out;
+	this->argCount = 0;
+	
+	//Split on spaces, tabs and stray carriage returns, terminating each word in place.
+	char* end = line + length;
+	while (line < end) {
+		while (line < end && (*line == ' ' || *line == '\t' || *line == '\r')) {
+			*(line++) = '\0';
+		}
+		if (line == end) {
+			break;
+		}
+		if (this->argCount == SERIAL_SHELL_ARGS) {
+			if (out) {
+				out->printf("too many arguments\n");
+			}
+			return serial_shellTooManyArgs;
+		}
+		this->args[this->argCount++] = line;
+		while (line < end && *line != ' ' && *line != '\t' && *line != '\r') {
+			line++;
+		}
+	}
+	*end = '\0'; // Callers leave room for this.
+	
+	if (this->argCount == 0) {
+		return serial_shellEmpty;
+	}
+	
+	const serialCommand_t* command = this->find(this->args[0]);
+	if (command) {
+		command->handler(this);
+		return serial_shellOk;
+	}
+	if (strcmp(this->args[0], "help") == 0) {
+		this->help();
+		return serial_shellOk;
+	}
+	if (out) {
+		out->printf("unknown command: %s\n", this->args[0]);
+	}
+	return serial_shellUnknown;
+}
+
+const serialCommand_t* serialShell_c::find(const char* name) 
+{
+	uint32_t low = 0;
+	uint32_t high = this->count;
+	
+	while (low < high) {
+		uint32_t middle = (low + high) / 2;
+		int order = strcmp(name, this->commands[middle].name);
+		if (order == 0) {
+			return &this->commands[middle];
+		}
+		if (order < 0) {
+			high = middle;
+		}
+		else {
+			low = middle + 1;
+		}
+	}
+	return NULL;
+}
+
+void serialShell_c::help(void) 
+{
+	if (!this->out) {
+		return;
+	}
+	for (uint32_t i = 0; i < this->count; i++) {
+		this->out->printf("%s\n", this->commands[i].help ? this->commands[i].help : this->commands[i].name);
+	}
+}
+
+
+uint32_t serialShell_c::ArgCount(void) 
+{
+	return this->argCount;
+}
+
+const char* serialShell_c::Arg(uint32_t index) 
+{
+	return (index < this->argCount) ? this->args[index] : NULL;
+}
+
+bool serialShell_c::ArgInt(uint32_t index, int32_t* value) 
+{
+	const char* text = this->Arg(index);
+	uint32_t base = 10;
+	int64_t number;
+	
+	if (text == NULL) {
+		return false;
+	}
+	if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+		base = 16;
+		text += 2;
+	}
+	else if (text[0] == '0' && (text[1] == 'b' || text[1] == 'B')) {
+		base = 2;
+		text += 2;
+	}
+	
+	//Prefixed values are bit patterns, so may use the full 32 bits.
+	if (!serialTextToNum(text, base, &number) || (base != 10 && *text == '-') 
+			|| number < INT32_MIN || number > ((base == 10) ? INT32_MAX : UINT32_MAX)) {
+		return false;
+	}
+	*value = (int32_t)number;
+	return true;
+}
+
+bool serialShell_c::ArgHex(uint32_t index, uint32_t* value) 
+{
+	const char* text = this->Arg(index);
+	int64_t number;
+	
+	if (text == NULL) {
+		return false;
+	}
+	if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+		text += 2;
+	}
+	if (*text == '-' || !serialTextToNum(text, 16, &number) || number > UINT32_MAX) {
+		return false;
+	}
+	*value = (uint32_t)number;
+	return true;
+}
+
+SerialStream* serialShell_c::Out(void) 
+{
+	return this->out;
+}
@@ -0,0 +1,120 @@
+/*
+ * serial-shell.hpp
+ * Command console over a UART or USART, dispatched from a constant table.
+ *
+ * Commands live in a constexpr table, sorted by name - which is checked at 
+ * compile time - so lookup is a binary search (9 short compares for 500 
+ * commands) with no RAM used for the table. Each line is taken with the 
+ * driver's LineGet(), split into arguments in place and handed to the 
+ * command's handler, which reads its arguments with Arg(), ArgInt() etc:
+ * 
+ *     void cmdLed(serialShell_c* shell) {
+ *         int32_t led;
+ *         if (!shell->ArgInt(1, &led)) shell->Out()->printf("led <n>\n");
+ *         ...
+ *     }
+ *     constexpr serialCommand_t commands[] = {
+ *         {"led", cmdLed, "led <n>: toggle LED n"},
+ *         {"reset", cmdReset, "reset: restart"},
+ *     };
+ *     SERIAL_SHELL_CHECK(commands);
+ *     serialShell_c shell(commands, sizeof(commands) / sizeof(commands[0]));
+ *     ...
+ *     shell.Poll(&samUART1); // In the main loop.
+ * 
+ * "help" lists the commands, unless the table has its own.
+ *
+ * Created: 17/10/2026
+ */
+
+
+#ifndef SERIAL_SHELL_HPP_
+#define SERIAL_SHELL_HPP_
+
+#include "serial-funcs.hpp"
+
+#define SERIAL_SHELL_LINE_LENGTH 80	// Longest command line, without the delimiter.
+#define SERIAL_SHELL_ARGS 8			// Most arguments per line, including the command name.
+
+class serialShell_c;
+
+typedef void (*serialCommandHandler_t)(serialShell_c* shell);
+
+struct serialCommand_t {
+	const char* name;
+	serialCommandHandler_t handler;
+	const char* help;	// One line for "help", or NULL.
+};
+
+//Result of one line:
+//	idle: no complete line waiting (Poll only).
+//	ok: the handler was run.
+//	empty: blank line.
+//	unknown: no such command.
+//	tooManyArgs: more than SERIAL_SHELL_ARGS words; the handler was not run.
+//	tooLong: over SERIAL_SHELL_LINE_LENGTH; refused whole, rather than cut short (Poll only).
+//	overrun: overwritten in the receive buffer before it was copied out (Poll only).
+enum {serial_shellIdle, serial_shellOk, serial_shellEmpty, serial_shellUnknown, serial_shellTooManyArgs, 
+	serial_shellTooLong, serial_shellOverrun};
+
+
+//Compile-time table check. The halving recursion keeps constexpr depth to 
+// log2 of the table length, so large tables don't hit the compiler's limit.
+constexpr int serialShellCompare(const char* a, const char* b) {
+	return (*a != *b || *a == 0) ? (uint8_t)*a - (uint8_t)*b : serialShellCompare(a + 1, b + 1);
+}
+constexpr bool serialShellSorted(const serialCommand_t* table, uint32_t count) {
+	return (count < 2) || (serialShellSorted(table, count / 2) 
+		&& serialShellCompare(table[count / 2 - 1].name, table[count / 2].name) < 0 
+		&& serialShellSorted(table + count / 2, count - count / 2));
+}
+
+//Use after the (constexpr) command table.
+#define SERIAL_SHELL_CHECK(table) \
+	static_assert(serialShellSorted(table, sizeof(table) / sizeof(table[0])), \
+		"serialShell_c: command table must be sorted by name, with no duplicates")
+
+
+class serialShell_c {
+	public:
+		//Initialiser, with the command table.
+		serialShell_c(const serialCommand_t* commands, uint32_t count);
+		
+		//Runs the next complete line waiting in the port's receive buffer, if 
+		// any, replying on the same port. Port is a samUART_c or samUSART_c. 
+		// Lines over SERIAL_SHELL_LINE_LENGTH are refused, whatever the port's LineConfig.
+		template <class port_t>
+		uint32_t Poll(port_t* port);
+		
+		//Runs one line, split into arguments in place, so line[length] must be 
+		// writable too. out may be NULL.
+		uint32_t Execute(char* line, uint32_t length, SerialStream* out);
+		
+		//For handlers: the arguments of the current line, Arg(0) being the 
+		// command name, and where to reply (may be NULL).
+		uint32_t ArgCount(void);
+		const char* Arg(uint32_t index);
+		//Decimal (with optional '-'), or hex with 0x or binary with 0b.
+		bool ArgInt(uint32_t index, int32_t* value);
+		//Hex, with or without 0x.
+		bool ArgHex(uint32_t index, uint32_t* value);
+		SerialStream* Out(void);
+	
+	private:
+		//Binary search of the table, NULL if not found.
+		const serialCommand_t* find(const char* name);
+		void help(void);
+		
+		const serialCommand_t* commands;
+		uint32_t count;
+		
+		//Current line:
+		char line[SERIAL_SHELL_LINE_LENGTH + 1];
+		char* args[SERIAL_SHELL_ARGS];
+		uint32_t argCount;
+		SerialStream* out;
+};
+
+#include "serial-shell.cpp"
+
+#endif /* SERIAL_SHELL_HPP_ */
@@ -58,6 +58,12 @@
 #include "Utilities/arduino-funcs.hpp"	// Some of the common Arduino functions e.g. map
 #include "Utilities/CircBuf.hpp"		// Circular buffer class with Malloc support
 #include "Utilities/samServo.hpp"		// Arduino style servo wrapper for PWM peripheral.
+#include "Utilities/samModbus.hpp"		// Modbus RTU slave over RS-485, on a USART.
+#include "Utilities/serial-log.hpp"		// Binary logging, decoded on the PC by Tools/serial-log-decode.
+#include "Utilities/serial-parse.hpp"	// Resumable scanf-style parser for commands arriving a few bytes at a time.
+#include "Utilities/serial-shell.hpp"	// Command console: sorted constant command table, arguments parsed in place.
+#include "Utilities/serial-packet.hpp"	// Binary packets over a serial port: COBS or SLIP framing with CRC-16/32.
+#include "Utilities/serial-mux.hpp"		// Several SerialStream channels sharing one port, with priorities and shares.
 //#include "Utilities/serial-funcs.hpp"	// Private. Used by UART and USART for printf, scanf etc implementation.
 
 